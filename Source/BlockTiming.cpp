@@ -0,0 +1,135 @@
+/*
+  ==============================================================================
+
+    Optional per-block timing of the processor, for chasing dropouts.
+
+  ==============================================================================
+*/
+
+#include "BlockTiming.h"
+
+#if CRUSHER_BLOCK_TIMING
+
+namespace Crusher
+{
+
+namespace
+{
+    // Only the audio thread writes, so a relaxed load and store do the job of a
+    // read-modify-write without its locked instruction
+    template <typename Type>
+    void add (std::atomic<Type>& counter, Type amount) noexcept
+    {
+        counter.store (counter.load (std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    template <typename Type>
+    void raiseTo (std::atomic<Type>& counter, Type value) noexcept
+    {
+        if (value > counter.load (std::memory_order_relaxed))
+            counter.store (value, std::memory_order_relaxed);
+    }
+}
+
+//==============================================================================
+void BlockTiming::record (juce::int64 elapsedTicks, int numSamples, double sampleRate) noexcept
+{
+    if (resetRequested.exchange (false, std::memory_order_acquire))
+    {
+        for (auto& bin : bins)
+            bin.store (0, std::memory_order_relaxed);
+
+        for (auto* counter : { &numBlocks, &numOverruns, &totalNanoseconds, &maxNanoseconds })
+            counter->store (0, std::memory_order_relaxed);
+
+        worstLoad.store (0.0, std::memory_order_relaxed);
+    }
+
+    const auto seconds = juce::Time::highResolutionTicksToSeconds (elapsedTicks);
+    const auto nanoseconds = (juce::uint64) juce::jmax (0.0, seconds * 1.0e9);
+
+    add (bins[(size_t) getBin (seconds)], (juce::uint64) 1);
+    add (numBlocks, (juce::uint64) 1);
+    add (totalNanoseconds, nanoseconds);
+    raiseTo (maxNanoseconds, nanoseconds);
+
+    if (numSamples > 0 && sampleRate > 0.0)
+    {
+        const auto budget = numSamples / sampleRate;
+
+        if (seconds > budget)
+            add (numOverruns, (juce::uint64) 1);
+
+        raiseTo (worstLoad, seconds / budget);
+        budgetSeconds.store (budget, std::memory_order_relaxed);
+    }
+}
+
+BlockTiming::Snapshot BlockTiming::getSnapshot() const noexcept
+{
+    Snapshot snapshot;
+
+    for (size_t bin = 0; bin < bins.size(); ++bin)
+        snapshot.bins[bin] = bins[bin].load (std::memory_order_relaxed);
+
+    snapshot.numBlocks = numBlocks.load (std::memory_order_relaxed);
+    snapshot.numOverruns = numOverruns.load (std::memory_order_relaxed);
+    snapshot.totalSeconds = (double) totalNanoseconds.load (std::memory_order_relaxed) * 1.0e-9;
+    snapshot.maxSeconds = (double) maxNanoseconds.load (std::memory_order_relaxed) * 1.0e-9;
+    snapshot.worstLoad = worstLoad.load (std::memory_order_relaxed);
+    snapshot.budgetSeconds = budgetSeconds.load (std::memory_order_relaxed);
+
+    return snapshot;
+}
+
+bool BlockTiming::writeReport (const juce::File& file) const
+{
+    return file.replaceWithText (getSnapshot().toText());
+}
+
+int BlockTiming::getBin (double seconds) noexcept
+{
+    if (seconds <= lowestBinSeconds)
+        return 0;
+
+    return juce::jlimit (0, numBins - 1, (int) (binsPerOctave * std::log2 (seconds / lowestBinSeconds)));
+}
+
+double BlockTiming::getBinLowerEdgeSeconds (int bin) noexcept
+{
+    return lowestBinSeconds * std::exp2 ((double) bin / binsPerOctave);
+}
+
+//==============================================================================
+juce::String BlockTiming::Snapshot::toText() const
+{
+    auto microseconds = [] (double seconds) { return juce::String (seconds * 1.0e6, 2); };
+
+    juce::String text;
+    text << "BitCrusher processBlock timing, " << juce::Time::getCurrentTime().toISO8601 (true) << juce::newLine
+         << "blocks: " << (juce::int64) numBlocks << juce::newLine
+         << "overruns: " << (juce::int64) numOverruns
+         << " (" << juce::String (numBlocks > 0 ? 100.0 * (double) numOverruns / (double) numBlocks : 0.0, 3) << " %)" << juce::newLine
+         << "mean us: " << microseconds (numBlocks > 0 ? totalSeconds / (double) numBlocks : 0.0) << juce::newLine
+         << "max us: " << microseconds (maxSeconds) << juce::newLine
+         << "latest budget us: " << microseconds (budgetSeconds) << juce::newLine
+         << "worst load %: " << juce::String (worstLoad * 100.0, 1) << juce::newLine
+         << juce::newLine
+         << "from us\tto us\tblocks" << juce::newLine;
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        if (bins[(size_t) bin] == 0)
+            continue;
+
+        text << microseconds (bin == 0 ? 0.0 : getBinLowerEdgeSeconds (bin)) << "\t"
+             << (bin == numBins - 1 ? juce::String ("inf") : microseconds (getBinLowerEdgeSeconds (bin + 1))) << "\t"
+             << (juce::int64) bins[(size_t) bin] << juce::newLine;
+    }
+
+    return text;
+}
+
+} // namespace Crusher
+
+#endif
@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    Optional per-block timing of the processor, for chasing dropouts.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+/** Builds the processBlock timing histogram, its editor overlay and the report
+    file when set to 1, e.g. from the project's preprocessor definitions. At 0,
+    the default, none of it is compiled in and processBlock is untouched.
+*/
+#ifndef CRUSHER_BLOCK_TIMING
+ #define CRUSHER_BLOCK_TIMING 0
+#endif
+
+#if CRUSHER_BLOCK_TIMING
+
+namespace Crusher
+{
+
+//==============================================================================
+/** How long each processBlock call took, as a histogram with a quarter octave per
+    bin, plus how many calls overran their real-time budget: the time the block's
+    samples last at the host's sample rate.
+
+    The audio thread is the only writer; any thread may take a snapshot. Counters
+    are relaxed atomics, so neither side locks, and a snapshot taken mid-update is
+    at worst one block behind in some of its figures.
+*/
+class BlockTiming
+{
+public:
+    static constexpr int numBins = 80;
+    static constexpr int binsPerOctave = 4;
+    static constexpr double lowestBinSeconds = 0.25e-6; // bin 0 also takes anything faster
+
+    struct Snapshot
+    {
+        std::array<juce::uint64, numBins> bins{};
+        juce::uint64 numBlocks = 0, numOverruns = 0;
+        double totalSeconds = 0.0, maxSeconds = 0.0;
+        double worstLoad = 0.0;     // the largest share of its budget one block used
+        double budgetSeconds = 0.0; // of the latest block
+
+        /** A plain text report: the totals, then one line per non-empty bin. */
+        juce::String toText() const;
+    };
+
+    /** Times one processBlock call, from construction to destruction. */
+    class Scope
+    {
+    public:
+        Scope (BlockTiming& owner, int numSamples, double sampleRate) noexcept
+            : timing (owner), blockSize (numSamples), rate (sampleRate), startTicks (juce::Time::getHighResolutionTicks())
+        {
+        }
+
+        ~Scope() { timing.record (juce::Time::getHighResolutionTicks() - startTicks, blockSize, rate); }
+
+    private:
+        BlockTiming& timing;
+        int blockSize;
+        double rate;
+        juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (Scope)
+    };
+
+    /** Audio thread: adds a call that took elapsedTicks (juce::Time high
+        resolution ticks) to process numSamples samples.
+    */
+    void record (juce::int64 elapsedTicks, int numSamples, double sampleRate) noexcept;
+
+    Snapshot getSnapshot() const noexcept;
+
+    /** Clears everything, the next time the audio thread records a block. */
+    void reset() noexcept { resetRequested.store (true, std::memory_order_release); }
+
+    /** Writes the current snapshot's report; false if the file couldn't be written. */
+    bool writeReport (const juce::File& file) const;
+
+    static int getBin (double seconds) noexcept;
+    static double getBinLowerEdgeSeconds (int bin) noexcept;
+
+private:
+    std::array<std::atomic<juce::uint64>, numBins> bins{};
+    std::atomic<juce::uint64> numBlocks { 0 }, numOverruns { 0 };
+    std::atomic<juce::uint64> totalNanoseconds { 0 }, maxNanoseconds { 0 };
+    std::atomic<double> worstLoad { 0.0 }, budgetSeconds { 0.0 };
+    std::atomic<bool> resetRequested { false };
+};
+
+} // namespace Crusher
+
+#endif
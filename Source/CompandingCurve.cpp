@@ -0,0 +1,392 @@
+/*
+  ==============================================================================
+
+    Non-uniform quantization curves: mu-law, A-law, logarithmic and user level
+    tables.
+
+  ==============================================================================
+*/
+
+#include "CompandingCurve.h"
+
+// Like the dither generator, the vector path sticks to SSE2 and NEON, which every
+// target that has them supports, so it needs no runtime dispatch
+#if JUCE_INTEL
+ #include <emmintrin.h>
+ #define CRUSHER_CURVE_SSE2 1
+#elif defined (__aarch64__) || defined (_M_ARM64)
+ #include <arm_neon.h>
+ #define CRUSHER_CURVE_NEON 1
+#endif
+
+namespace Crusher
+{
+
+namespace
+{
+    // Floats from 2^-24 up to 1.0 map onto the compressor table by their top bits:
+    // the exponent picks the octave and the first five mantissa bits the bucket
+    constexpr juce::uint32 lowestBits = (juce::uint32) (127 - CompandingCurve::numOctaves) << 23;
+    constexpr int bucketShift = 23 - 5;
+    constexpr float bucketFraction = 1.f / (float) (1 << bucketShift);
+    constexpr float lowestMagnitude = 1.f / (float) (1 << CompandingCurve::numOctaves);
+
+    static_assert (CompandingCurve::bucketsPerOctave == 1 << (23 - bucketShift), "buckets must match the mantissa bits used");
+
+    constexpr double muLaw = 255.0;
+    constexpr double aLaw = 87.6;
+    constexpr double logRangeDecibels = 60.0;
+}
+
+//==============================================================================
+CompandingCurve::CompandingCurve()
+{
+    build (CurveType::linear);
+}
+
+void CompandingCurve::build (CurveType type)
+{
+    switch (type)
+    {
+        case CurveType::muLaw:
+            fillTables ([] (double x) { return std::log1p (muLaw * x) / std::log1p (muLaw); },
+                        [] (double c) { return std::expm1 (c * std::log1p (muLaw)) / muLaw; });
+            break;
+
+        case CurveType::aLaw:
+        {
+            const auto k = 1.0 + std::log (aLaw);
+
+            fillTables ([k] (double x) { return x < 1.0 / aLaw ? aLaw * x / k : (1.0 + std::log (aLaw * x)) / k; },
+                        [k] (double c) { return c < 1.0 / k ? c * k / aLaw : std::exp (c * k - 1.0) / aLaw; });
+            break;
+        }
+
+        case CurveType::logarithmic:
+        {
+            // Zero stays zero; everything from the bottom of the range up is evenly spaced in dB
+            const auto decades = logRangeDecibels / 20.0;
+
+            fillTables ([decades] (double x) { return juce::jmax (0.0, 1.0 + std::log10 (x) / decades); },
+                        [decades] (double c) { return c > 0.0 ? std::pow (10.0, (c - 1.0) * decades) : 0.0; });
+            break;
+        }
+
+        case CurveType::linear:
+        case CurveType::user:
+        default:
+            fillTables ([] (double x) { return x; }, [] (double c) { return c; });
+            break;
+    }
+}
+
+void CompandingCurve::buildFromLevels (const juce::Array<float>& levels)
+{
+    std::vector<double> points { 0.0 };
+
+    for (auto level : levels)
+        if (level > 0.f && level <= 1.f)
+            points.push_back ((double) level);
+
+    std::sort (points.begin(), points.end());
+    points.erase (std::unique (points.begin(), points.end()), points.end());
+
+    if (points.back() < 1.0)
+        points.push_back (1.0);
+
+    // Piecewise linear, with the i-th level landing on i / numLevels
+    const auto numSegments = (double) (points.size() - 1);
+
+    fillTables ([&points, numSegments] (double x)
+                {
+                    auto upper = std::upper_bound (points.begin(), points.end(), x);
+
+                    if (upper == points.end())
+                        return 1.0;
+
+                    auto i = (size_t) (upper - points.begin()) - 1;
+                    return ((double) i + (x - points[i]) / (points[i + 1] - points[i])) / numSegments;
+                },
+                [&points, numSegments] (double c)
+                {
+                    auto position = c * numSegments;
+                    auto i = juce::jmin ((size_t) position, points.size() - 2);
+                    return points[i] + (position - (double) i) * (points[i + 1] - points[i]);
+                });
+}
+
+template <typename Compressor, typename Expander>
+void CompandingCurve::fillTables (Compressor compressorFn, Expander expanderFn)
+{
+    for (int i = 0; i < compressorSize; ++i)
+    {
+        auto entry = juce::jmin (i, compressorSize - 2);
+        auto magnitude = std::ldexp (1.0 + (double) (entry % bucketsPerOctave) / bucketsPerOctave,
+                                     entry / bucketsPerOctave - numOctaves);
+
+        compressor[(size_t) i] = (float) juce::jlimit (0.0, 1.0, compressorFn (magnitude));
+    }
+
+    smallSignalSlope = compressor[0] / lowestMagnitude;
+
+    for (int i = 0; i <= expanderSegments; ++i)
+        expander[(size_t) i] = (float) juce::jlimit (0.0, 1.0, expanderFn ((double) i / expanderSegments));
+}
+
+namespace
+{
+   #if CRUSHER_CURVE_SSE2
+    using FloatVector = __m128;
+    using IntVector = __m128i;
+
+    inline FloatVector loadFloats (const float* src) noexcept               { return _mm_loadu_ps (src); }
+    inline void storeFloats (float* dest, FloatVector v) noexcept           { _mm_storeu_ps (dest, v); }
+    inline void storeInts (juce::uint32* dest, IntVector v) noexcept        { _mm_storeu_si128 ((__m128i*) dest, v); }
+    inline FloatVector setFloats (float x) noexcept                         { return _mm_set1_ps (x); }
+    inline IntVector setInts (juce::uint32 x) noexcept                      { return _mm_set1_epi32 ((int) x); }
+    inline FloatVector add (FloatVector a, FloatVector b) noexcept          { return _mm_add_ps (a, b); }
+    inline FloatVector sub (FloatVector a, FloatVector b) noexcept          { return _mm_sub_ps (a, b); }
+    inline FloatVector mul (FloatVector a, FloatVector b) noexcept          { return _mm_mul_ps (a, b); }
+
+    // Returns b when a is NaN, so min (x, limit) always lands within the tables
+    inline FloatVector min (FloatVector a, FloatVector b) noexcept          { return _mm_min_ps (a, b); }
+    inline FloatVector abs (FloatVector a) noexcept                         { return _mm_andnot_ps (_mm_set1_ps (-0.f), a); }
+    inline FloatVector copySign (FloatVector mag, FloatVector sign) noexcept
+    {
+        return _mm_or_ps (mag, _mm_and_ps (sign, _mm_set1_ps (-0.f)));
+    }
+    inline IntVector toBits (FloatVector a) noexcept                        { return _mm_castps_si128 (a); }
+    inline IntVector subInts (IntVector a, IntVector b) noexcept            { return _mm_sub_epi32 (a, b); }
+    inline IntVector andInts (IntVector a, IntVector b) noexcept            { return _mm_and_si128 (a, b); }
+    inline IntVector andNotInts (IntVector mask, IntVector a) noexcept      { return _mm_andnot_si128 (mask, a); }
+    template <int shift> IntVector shiftRight (IntVector a) noexcept        { return _mm_srli_epi32 (a, shift); }
+    inline FloatVector intsToFloats (IntVector a) noexcept                  { return _mm_cvtepi32_ps (a); }
+    inline IntVector truncateToInts (FloatVector a) noexcept                { return _mm_cvttps_epi32 (a); }
+
+    // Both sides are below 2^31 wherever this is used, so a signed compare does
+    inline IntVector lessThan (IntVector a, IntVector b) noexcept           { return _mm_cmplt_epi32 (a, b); }
+
+    inline FloatVector select (IntVector mask, FloatVector a, FloatVector b) noexcept
+    {
+        const auto m = _mm_castsi128_ps (mask);
+        return _mm_or_ps (_mm_and_ps (m, a), _mm_andnot_ps (m, b));
+    }
+
+    /** Rounds up non-negative values. Truncating only works below 2^23, but from
+        there on every float is a whole number already.
+    */
+    inline FloatVector ceilPositive (FloatVector a) noexcept
+    {
+        const auto limit = _mm_set1_ps (8388608.f);
+        const auto small = _mm_min_ps (a, limit);
+        auto k = _mm_cvtepi32_ps (_mm_cvttps_epi32 (small));
+        k = _mm_add_ps (k, _mm_and_ps (_mm_cmplt_ps (k, small), _mm_set1_ps (1.f)));
+        return _mm_max_ps (k, a);
+    }
+   #elif CRUSHER_CURVE_NEON
+    using FloatVector = float32x4_t;
+    using IntVector = uint32x4_t;
+
+    inline FloatVector loadFloats (const float* src) noexcept               { return vld1q_f32 (src); }
+    inline void storeFloats (float* dest, FloatVector v) noexcept           { vst1q_f32 (dest, v); }
+    inline void storeInts (juce::uint32* dest, IntVector v) noexcept        { vst1q_u32 (dest, v); }
+    inline FloatVector setFloats (float x) noexcept                         { return vdupq_n_f32 (x); }
+    inline IntVector setInts (juce::uint32 x) noexcept                      { return vdupq_n_u32 (x); }
+    inline FloatVector add (FloatVector a, FloatVector b) noexcept          { return vaddq_f32 (a, b); }
+    inline FloatVector sub (FloatVector a, FloatVector b) noexcept          { return vsubq_f32 (a, b); }
+    inline FloatVector mul (FloatVector a, FloatVector b) noexcept          { return vmulq_f32 (a, b); }
+
+    // vminq_f32 would pass a NaN on; vminnmq_f32 returns the number, like the SSE2 min above
+    inline FloatVector min (FloatVector a, FloatVector b) noexcept          { return vminnmq_f32 (a, b); }
+    inline FloatVector abs (FloatVector a) noexcept                         { return vabsq_f32 (a); }
+    inline FloatVector copySign (FloatVector mag, FloatVector sign) noexcept
+    {
+        return vbslq_f32 (vdupq_n_u32 (0x80000000u), sign, mag);
+    }
+    inline IntVector toBits (FloatVector a) noexcept                        { return vreinterpretq_u32_f32 (a); }
+    inline IntVector subInts (IntVector a, IntVector b) noexcept            { return vsubq_u32 (a, b); }
+    inline IntVector andInts (IntVector a, IntVector b) noexcept            { return vandq_u32 (a, b); }
+    inline IntVector andNotInts (IntVector mask, IntVector a) noexcept      { return vbicq_u32 (a, mask); }
+    template <int shift> IntVector shiftRight (IntVector a) noexcept        { return vshrq_n_u32 (a, shift); }
+    inline FloatVector intsToFloats (IntVector a) noexcept                  { return vcvtq_f32_u32 (a); }
+    inline IntVector truncateToInts (FloatVector a) noexcept                { return vcvtq_u32_f32 (a); }
+    inline IntVector lessThan (IntVector a, IntVector b) noexcept           { return vcltq_u32 (a, b); }
+    inline FloatVector select (IntVector mask, FloatVector a, FloatVector b) noexcept { return vbslq_f32 (mask, a, b); }
+    inline FloatVector ceilPositive (FloatVector a) noexcept                { return vrndpq_f32 (a); }
+   #endif
+
+   #if CRUSHER_CURVE_SSE2 || CRUSHER_CURVE_NEON
+    /** Linearly interpolates a table at four positions. SSE2 and NEON have no
+        gather, so the entries are read one lane at a time, straight into
+        registers; going through memory would stall on store forwarding.
+    */
+    inline FloatVector interpolate (const float* table, IntVector index, FloatVector fraction) noexcept
+    {
+        alignas (16) juce::uint32 i[4];
+        storeInts (i, index);
+
+       #if CRUSHER_CURVE_SSE2
+        const auto lower = _mm_setr_ps (table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+        const auto upper = _mm_setr_ps (table[i[0] + 1], table[i[1] + 1], table[i[2] + 1], table[i[3] + 1]);
+       #else
+        const float lowerValues[] = { table[i[0]], table[i[1]], table[i[2]], table[i[3]] };
+        const float upperValues[] = { table[i[0] + 1], table[i[1] + 1], table[i[2] + 1], table[i[3] + 1] };
+        const auto lower = vld1q_f32 (lowerValues);
+        const auto upper = vld1q_f32 (upperValues);
+       #endif
+
+        return add (lower, mul (fraction, sub (upper, lower)));
+    }
+   #endif
+}
+
+template <typename SampleType>
+void CompandingCurve::process (SampleType* data, int numSamples, const float* noise,
+                               const float* bitSteps, const float* wet, int stride) const noexcept
+{
+    // Short chunks: parameters and input are staged as floats, the curve runs over
+    // them four lanes at a time, and the result is mixed back in the sample type
+    constexpr int chunkSize = 64;
+
+    alignas (16) std::array<float, chunkSize> input, output, steps, stepSizes, dither;
+
+    // Steady parameters and no dither are staged once for the whole call
+    if (stride == 0)
+    {
+        steps.fill (bitSteps[0]);
+        stepSizes.fill (1.f / bitSteps[0]);
+    }
+
+    if (noise == nullptr)
+        dither.fill (0.f);
+
+    for (int start = 0; start < numSamples; start += chunkSize)
+    {
+        const auto n = juce::jmin (chunkSize, numSamples - start);
+        auto* x = data + start;
+
+        for (int i = 0; i < n; ++i)
+            input[(size_t) i] = (float) x[i];
+
+        if (stride != 0)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                steps[(size_t) i] = bitSteps[(start + i) * stride];
+                stepSizes[(size_t) i] = 1.f / steps[(size_t) i];
+            }
+        }
+
+        if (noise != nullptr)
+            std::copy_n (noise + start, n, dither.data());
+
+        int i = 0;
+
+       #if CRUSHER_CURVE_SSE2 || CRUSHER_CURVE_NEON
+        constexpr int numLanes = 4;
+
+        const auto one = setFloats (1.f);
+        const auto lowest = setInts (lowestBits);
+        const auto bucketMask = setInts ((1u << bucketShift) - 1);
+        const auto fractionScale = setFloats (bucketFraction);
+        const auto slope = setFloats (smallSignalSlope);
+        const auto segments = setFloats ((float) expanderSegments);
+        const auto lastSegment = setFloats ((float) (expanderSegments - 1));
+
+        for (; i + numLanes <= n; i += numLanes)
+        {
+            const auto v = loadFloats (input.data() + i);
+            const auto magnitude = min (abs (v), one);
+
+            // Compressor: the index comes from the bit pattern; below the table the
+            // curve is a straight line, and the wrapped-around index is masked to 0
+            const auto bits = toBits (magnitude);
+            const auto offset = subInts (bits, lowest);
+            const auto belowTable = lessThan (bits, lowest);
+
+            const auto fraction = mul (intsToFloats (andInts (offset, bucketMask)), fractionScale);
+            const auto interpolated = interpolate (compressor.data(), andNotInts (belowTable, shiftRight<bucketShift> (offset)), fraction);
+
+            auto c = copySign (select (belowTable, mul (magnitude, slope), interpolated), v);
+            c = add (c, mul (loadFloats (dither.data() + i), loadFloats (stepSizes.data() + i)));
+
+            // The even grid on the compressed scale, rounded away from zero
+            const auto q = min (mul (ceilPositive (mul (abs (c), loadFloats (steps.data() + i))),
+                                     loadFloats (stepSizes.data() + i)), one);
+
+            // Expander
+            const auto position = mul (q, segments);
+            const auto index = truncateToInts (min (position, lastSegment));
+
+            const auto y = interpolate (expander.data(), index, sub (position, intsToFloats (index)));
+
+            storeFloats (output.data() + i, copySign (y, c));
+        }
+       #endif
+
+        // The same steps one sample at a time, for the tail or when there are no vectors.
+        // The clamps are written so a NaN fails the comparison and becomes 1, as with
+        // the vector min; otherwise its bits would index far past the compressor table.
+        for (; i < n; ++i)
+        {
+            const auto v = input[(size_t) i];
+            const auto magnitude = std::abs (v) < 1.f ? std::abs (v) : 1.f;
+
+            juce::uint32 bits;
+            std::memcpy (&bits, &magnitude, sizeof (bits));
+
+            auto compressed = magnitude * smallSignalSlope;
+
+            if (bits >= lowestBits)
+            {
+                const auto offset = bits - lowestBits;
+                const auto* entry = compressor.data() + (offset >> bucketShift);
+                const auto fraction = (float) (juce::int32) (offset & ((1u << bucketShift) - 1)) * bucketFraction;
+                compressed = entry[0] + fraction * (entry[1] - entry[0]);
+            }
+
+            const auto c = std::copysign (compressed, v) + dither[(size_t) i] * stepSizes[(size_t) i];
+            const auto rounded = std::ceil (std::abs (c) * steps[(size_t) i]) * stepSizes[(size_t) i];
+            const auto q = rounded < 1.f ? rounded : 1.f;
+
+            const auto position = q * (float) expanderSegments;
+            const auto index = juce::jmin ((int) position, expanderSegments - 1);
+            const auto* entry = expander.data() + index;
+            const auto fraction = position - (float) index;
+
+            output[(size_t) i] = std::copysign (entry[0] + fraction * (entry[1] - entry[0]), c);
+        }
+
+        for (int j = 0; j < n; ++j)
+        {
+            const auto w = (SampleType) wet[(start + j) * stride];
+            x[j] = (SampleType) output[(size_t) j] * w + x[j] * ((SampleType) 1 - w);
+        }
+    }
+}
+
+juce::String CompandingCurve::levelsToString (const juce::Array<float>& levels)
+{
+    juce::StringArray tokens;
+
+    for (auto level : levels)
+        tokens.add (juce::String (level));
+
+    return tokens.joinIntoString (" ");
+}
+
+juce::Array<float> CompandingCurve::levelsFromString (const juce::String& text)
+{
+    juce::Array<float> levels;
+
+    for (const auto& token : juce::StringArray::fromTokens (text, " ,;", {}))
+        if (token.trim().isNotEmpty())
+            levels.add (token.getFloatValue());
+
+    return levels;
+}
+
+template void CompandingCurve::process<float> (float*, int, const float*, const float*, const float*, int) const noexcept;
+template void CompandingCurve::process<double> (double*, int, const float*, const float*, const float*, int) const noexcept;
+
+} // namespace Crusher
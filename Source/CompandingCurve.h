@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    Non-uniform quantization curves: mu-law, A-law, logarithmic and user level
+    tables.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Crusher
+{
+
+enum class CurveType
+{
+    linear,
+    muLaw,
+    aLaw,
+    logarithmic,
+    user
+};
+
+//==============================================================================
+/** A quantizer with unevenly spaced levels, built the way companding codecs work:
+    the magnitude is compressed onto 0..1, quantized onto the usual even grid of
+    1 / bitSteps there, and expanded back.
+
+    Both curves are lookup tables with linear interpolation, about 7 KB in total,
+    so they stay in L1 and a sample costs two table reads instead of a log and an
+    exp. The compressor is indexed straight from the float bit pattern, 32
+    entries per octave over 24 octaves, which follows the near-logarithmic shape
+    of all these curves; the expander is indexed from the scaled grid value.
+    Magnitudes above full scale saturate, as they would in a codec.
+
+    Building the tables allocates nothing but isn't cheap; do it off the audio
+    thread. process is const and safe to call from any thread.
+*/
+class CompandingCurve
+{
+public:
+    static constexpr int bucketsPerOctave = 32;
+    static constexpr int numOctaves = 24;
+    static constexpr int compressorSize = numOctaves * bucketsPerOctave + 2; // one spare entry to interpolate towards
+    static constexpr int expanderSegments = 1024;
+
+    /** Starts out as a straight line, i.e. the plain linear quantizer. */
+    CompandingCurve();
+
+    /** Builds one of the fixed curves: mu-law with mu = 255, A-law with A = 87.6,
+        or logarithmic, with levels evenly spaced in dB over a 60 dB range. Linear
+        and user give a straight line.
+    */
+    void build (CurveType type);
+
+    /** Builds a user curve from quantization levels between 0 and 1 (exclusive and
+        inclusive); with Bit Steps set to their number, these are the levels the
+        quantizer produces, to within the expander table's interpolation (a small
+        fraction of a percent). Out-of-range and duplicate values are ignored and
+        1 is added if missing.
+    */
+    void buildFromLevels (const juce::Array<float>& levels);
+
+    /** Quantizes and mixes one channel in place, like the kernels. noise is
+        per-sample dither in steps, added on the compressed scale, or nullptr for
+        none; bitSteps and wet are read with the given stride, so a stride of 0
+        holds them constant over the whole block.
+    */
+    template <typename SampleType>
+    void process (SampleType* data, int numSamples, const float* noise,
+                  const float* bitSteps, const float* wet, int stride) const noexcept;
+
+    /** The text form of a level table used in the plugin state: the levels
+        separated by spaces.
+    */
+    static juce::String levelsToString (const juce::Array<float>& levels);
+    static juce::Array<float> levelsFromString (const juce::String& text);
+
+private:
+    template <typename Compressor, typename Expander>
+    void fillTables (Compressor compressor, Expander expander);
+
+
+    std::array<float, compressorSize> compressor{};
+    std::array<float, expanderSegments + 1> expander{};
+    float smallSignalSlope = 1.f; // below the table's lowest octave the curve is treated as a straight line
+};
+
+} // namespace Crusher
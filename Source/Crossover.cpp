@@ -0,0 +1,159 @@
+/*
+  ==============================================================================
+
+    Linkwitz-Riley crossover splitting the signal into up to four bands.
+
+  ==============================================================================
+*/
+
+#include "Crossover.h"
+
+namespace Crusher
+{
+
+namespace
+{
+    /** One trapezoidal state variable filter stage over every lane. The rows don't
+        overlap, which the compiler needs to be told before it vectorizes this. */
+    template <typename SampleType>
+    void processStage (SampleType* __restrict v, SampleType* __restrict s1, SampleType* __restrict s2,
+                       const SampleType* __restrict k1, const SampleType* __restrict k2, const SampleType* __restrict k3,
+                       const SampleType* __restrict m0, const SampleType* __restrict m1, const SampleType* __restrict m2,
+                       int numLanes) noexcept
+    {
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            const auto in = v[lane];
+            const auto x3 = in - s2[lane];
+            const auto x1 = k1[lane] * s1[lane] + k2[lane] * x3;
+            const auto x2 = s2[lane] + k2[lane] * s1[lane] + k3[lane] * x3;
+
+            s1[lane] = 2 * x1 - s1[lane];
+            s2[lane] = 2 * x2 - s2[lane];
+            v[lane] = m0[lane] * in + m1[lane] * x1 + m2[lane] * x2;
+        }
+    }
+}
+
+template <typename SampleType>
+void LinkwitzRileyCrossover<SampleType>::prepare (int newNumChannels, int maxBlockSize)
+{
+    numChannels = newNumChannels;
+    maxLanes = numChannels * maxBands;
+    blockSize = maxBlockSize;
+
+    for (auto* row : { &ic1, &ic2, &a1, &a2, &a3, &c0, &c1, &c2 })
+        row->assign ((size_t) (maxStages * maxLanes), SampleType (0));
+
+    lanes.assign ((size_t) maxLanes, SampleType (0));
+    bands.assign ((size_t) (maxBands * numChannels * blockSize), SampleType (0));
+    numBands = 0; // coefficients are worked out on first use
+}
+
+template <typename SampleType>
+void LinkwitzRileyCrossover<SampleType>::setSampleRate (double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    numBands = 0;
+    reset();
+}
+
+template <typename SampleType>
+void LinkwitzRileyCrossover<SampleType>::reset() noexcept
+{
+    std::fill (ic1.begin(), ic1.end(), SampleType (0));
+    std::fill (ic2.begin(), ic2.end(), SampleType (0));
+}
+
+template <typename SampleType>
+SampleType* LinkwitzRileyCrossover<SampleType>::getBand (int band, int channel) noexcept
+{
+    return bands.data() + (size_t) ((band * numChannels + channel) * blockSize);
+}
+
+template <typename SampleType>
+void LinkwitzRileyCrossover<SampleType>::updateCoefficients (int newNumBands,
+                                                             const std::array<float, maxBands - 1>& frequencies) noexcept
+{
+    if (newNumBands != numBands)
+        reset(); // the lanes now mean something else
+
+    numBands = newNumBands;
+    currentFrequencies = frequencies;
+
+    // Butterworth state variable filters; two in a row make a Linkwitz-Riley section
+    const auto k = std::sqrt ((SampleType) 2);
+    const auto numSections = numBands - 1;
+
+    for (int section = 0; section < numSections; ++section)
+    {
+        const auto frequency = juce::jlimit (10.0, 0.49 * sampleRate, (double) frequencies[(size_t) section]);
+        const auto g = (SampleType) std::tan (juce::MathConstants<double>::pi * frequency / sampleRate);
+        const auto filterA1 = (SampleType) 1 / ((SampleType) 1 + g * (g + k));
+
+        for (int stage = section * stagesPerSection; stage < (section + 1) * stagesPerSection; ++stage)
+        {
+            const auto isFirstOfSection = stage == section * stagesPerSection;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                for (int band = 0; band < numBands; ++band)
+                {
+                    const auto i = (size_t) (stage * maxLanes + channel * numBands + band);
+
+                    a1[i] = filterA1;
+                    a2[i] = g * filterA1;
+                    a3[i] = g * g * filterA1;
+
+                    // out = c0 * in + c1 * bandpass + c2 * lowpass
+                    if (band == section)         { c0[i] = 0;  c1[i] = 0;  c2[i] = 1; }  // lowpass
+                    else if (band > section)     { c0[i] = 1;  c1[i] = -k; c2[i] = -1; } // highpass
+                    else if (isFirstOfSection)   { c0[i] = 1;  c1[i] = -2 * k; c2[i] = 0; } // allpass
+                    else                         { c0[i] = 1;  c1[i] = 0;  c2[i] = 0; }  // through
+                }
+            }
+        }
+    }
+}
+
+template <typename SampleType>
+void LinkwitzRileyCrossover<SampleType>::process (const juce::dsp::AudioBlock<SampleType>& block, int newNumBands,
+                                                  const std::array<float, maxBands - 1>& frequencies) noexcept
+{
+    newNumBands = juce::jlimit (2, maxBands, newNumBands);
+
+    if (newNumBands != numBands || frequencies != currentFrequencies)
+        updateCoefficients (newNumBands, frequencies);
+
+    const auto numSamples = juce::jmin ((int) block.getNumSamples(), blockSize);
+    const auto channels = juce::jmin ((int) block.getNumChannels(), numChannels);
+    const auto numLanes = channels * numBands;
+    const auto numStages = (numBands - 1) * stagesPerSection;
+
+    auto* v = lanes.data();
+
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        // Every band of a channel starts from the same input sample
+        for (int channel = 0; channel < channels; ++channel)
+            std::fill (v + channel * numBands, v + (channel + 1) * numBands, block.getSample (channel, smp));
+
+        for (int stage = 0; stage < numStages; ++stage)
+        {
+            const auto offset = (size_t) (stage * maxLanes);
+
+            processStage (v, ic1.data() + offset, ic2.data() + offset,
+                          a1.data() + offset, a2.data() + offset, a3.data() + offset,
+                          c0.data() + offset, c1.data() + offset, c2.data() + offset, numLanes);
+        }
+
+        for (int channel = 0; channel < channels; ++channel)
+            for (int band = 0; band < numBands; ++band)
+                getBand (band, channel)[smp] = v[channel * numBands + band];
+    }
+}
+
+template class LinkwitzRileyCrossover<float>;
+template class LinkwitzRileyCrossover<double>;
+
+} // namespace Crusher
@@ -0,0 +1,69 @@
+/*
+  ==============================================================================
+
+    Linkwitz-Riley crossover splitting the signal into up to four bands.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Crusher
+{
+
+//==============================================================================
+/** Splits every channel into 2 to 4 bands that add back up to an allpassed copy
+    of the input, so the bands can be processed separately and summed without
+    notches or humps at the crossover frequencies.
+
+    Rather than the usual tree of filters, each band is its own cascade with one
+    4th order Linkwitz-Riley section per crossover: lowpass at its upper edge,
+    highpass at each crossover below it, and the matching allpass at each one
+    above it, which is what keeps the bands in phase. That makes every (band,
+    channel) pair an independent lane running the same chain of state variable
+    filters, so the state and coefficients are stored as structure of arrays,
+    one contiguous row per filter stage, and each stage is one vectorized pass
+    over all bands and channels at once.
+*/
+template <typename SampleType>
+class LinkwitzRileyCrossover
+{
+public:
+    static constexpr int maxBands = 4;
+
+    /** Allocates for the given number of channels and block size. */
+    void prepare (int numChannels, int maxBlockSize);
+    void setSampleRate (double newSampleRate);
+    void reset() noexcept;
+
+    /** Splits the block into numBands bands, read back with getBand. The
+        crossover frequencies are in Hz, in ascending order, and only the first
+        numBands - 1 are used.
+    */
+    void process (const juce::dsp::AudioBlock<SampleType>& block, int numBands,
+                  const std::array<float, maxBands - 1>& frequencies) noexcept;
+
+    SampleType* getBand (int band, int channel) noexcept;
+
+private:
+    static constexpr int stagesPerSection = 2;
+    static constexpr int maxStages = (maxBands - 1) * stagesPerSection;
+
+    void updateCoefficients (int newNumBands, const std::array<float, maxBands - 1>& frequencies) noexcept;
+
+    int numChannels = 0, maxLanes = 0, blockSize = 0;
+    int numBands = 0;
+    std::array<float, maxBands - 1> currentFrequencies{};
+    double sampleRate = 44100.0;
+
+    // One row of maxLanes per stage, lane = channel * numBands + band
+    std::vector<SampleType> ic1, ic2;          // the two integrator states
+    std::vector<SampleType> a1, a2, a3;        // the filter's coefficients
+    std::vector<SampleType> c0, c1, c2;        // which mix of its outputs the stage passes on
+    std::vector<SampleType> lanes;             // the signal between stages, one sample per lane
+    std::vector<SampleType> bands;             // [band][channel][sample]
+};
+
+} // namespace Crusher
@@ -0,0 +1,840 @@
+/*
+  ==============================================================================
+
+    Vectorized quantize-and-mix kernels for the bit crusher.
+
+    Every variant is compiled into the binary and the best one is picked at
+    load time from the CPU features reported by juce::SystemStats, so a single
+    build runs everywhere and still uses the widest vectors available.
+
+    Positive samples are rounded up and negative samples down. That is the same
+    as rounding the magnitude up and restoring the sign, which is how all
+    variants below do it, without branches. The divide by bitSteps is kept
+    (rather than a multiply by the reciprocal), in the steady kernels as well as
+    the ramps, so the output is bit identical to the scalar reference and doesn't
+    change when a parameter ramp starts or ends.
+
+    The loops are written once, against a small set of register operations
+    (the *Ops structs), and instantiated for float and double on each
+    instruction set.
+
+  ==============================================================================
+*/
+
+#include "CrusherKernel.h"
+
+// GCC fuses a multiply and an add into an FMA wherever the target has one (and
+// avx512f implies it), which rounds once instead of twice; the vector loops
+// have to round like the scalar reference
+#if JUCE_GCC
+ #pragma GCC optimize ("fp-contract=off")
+#endif
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #define CRUSHER_HAS_X86_KERNELS 1
+ #if JUCE_MSVC
+  #define CRUSHER_TARGET(isa)
+ #else
+  #define CRUSHER_TARGET(isa) __attribute__ ((target (isa)))
+ #endif
+#elif defined (__aarch64__) || defined (_M_ARM64)
+ #include <arm_neon.h>
+ #define CRUSHER_HAS_NEON_KERNELS 1
+ #define CRUSHER_TARGET(isa)
+#endif
+
+namespace Crusher
+{
+
+//==============================================================================
+template <typename SampleType>
+static void quantizeMixScalar (SampleType* data, int numSamples, const Coefficients& coeffs) noexcept
+{
+    const auto steps = (SampleType) coeffs.bitSteps;
+    const auto wet = (SampleType) coeffs.wet;
+    const auto dry = (SampleType) coeffs.dry;
+
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        const auto x = data[smp];
+        const auto q = std::copysign (std::ceil (std::abs (x) * steps) / steps, x);
+
+        data[smp] = q * wet + x * dry;
+    }
+}
+
+template <typename SampleType>
+static void quantizeMixRampScalar (SampleType* data, int numSamples, const float* bitSteps, const float* wet) noexcept
+{
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        const auto x = data[smp];
+        const auto steps = (SampleType) bitSteps[smp];
+        const auto w = (SampleType) wet[smp];
+        const auto q = std::copysign (std::ceil (std::abs (x) * steps) / steps, x);
+
+        data[smp] = q * w + x * ((SampleType) 1 - w);
+    }
+}
+
+/*  The dithered quantizers work in units of one step: the noise is added to
+    x * steps, which is then rounded up in magnitude, so the only divide is the
+    one the plain quantizer has too.
+*/
+template <typename SampleType>
+static void quantizeMixNoiseScalar (SampleType* data, int numSamples, const Coefficients& coeffs, const float* noise) noexcept
+{
+    const auto steps = (SampleType) coeffs.bitSteps;
+    const auto wet = (SampleType) coeffs.wet;
+    const auto dry = (SampleType) coeffs.dry;
+
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        const auto x = data[smp];
+        const auto t = x * steps + (SampleType) noise[smp];
+        const auto q = std::copysign (std::ceil (std::abs (t)) / steps, t);
+
+        data[smp] = q * wet + x * dry;
+    }
+}
+
+template <typename SampleType>
+static void quantizeMixRampNoiseScalar (SampleType* data, int numSamples, const float* bitSteps, const float* wet,
+                                        const float* noise) noexcept
+{
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        const auto x = data[smp];
+        const auto steps = (SampleType) bitSteps[smp];
+        const auto w = (SampleType) wet[smp];
+        const auto t = x * steps + (SampleType) noise[smp];
+        const auto q = std::copysign (std::ceil (std::abs (t)) / steps, t);
+
+        data[smp] = q * w + x * ((SampleType) 1 - w);
+    }
+}
+
+template <typename SampleType>
+static void quantizeMixDitherScalar (SampleType* data, int numSamples, const Coefficients& coeffs,
+                                     DitherNoise& noise, DitherMode mode) noexcept
+{
+    std::array<float, DitherNoise::numLanes> values;
+
+    for (int smp = 0; smp < numSamples; smp += DitherNoise::numLanes)
+    {
+        noise.fill (mode, values.data(), DitherNoise::numLanes);
+        quantizeMixNoiseScalar (data + smp, juce::jmin (DitherNoise::numLanes, numSamples - smp), coeffs, values.data());
+    }
+}
+
+template <typename SampleType>
+static void quantizeMixRampDitherScalar (SampleType* data, int numSamples, const float* bitSteps, const float* wet,
+                                         DitherNoise& noise, DitherMode mode) noexcept
+{
+    std::array<float, DitherNoise::numLanes> values;
+
+    for (int smp = 0; smp < numSamples; smp += DitherNoise::numLanes)
+    {
+        noise.fill (mode, values.data(), DitherNoise::numLanes);
+        quantizeMixRampNoiseScalar (data + smp, juce::jmin (DitherNoise::numLanes, numSamples - smp),
+                                    bitSteps + smp, wet + smp, values.data());
+    }
+}
+
+template <typename SampleType>
+static void quantizeMixMidSideScalar (SampleType* left, SampleType* right, int numSamples,
+                                      const Coefficients& mid, const Coefficients& side) noexcept
+{
+    const auto half = (SampleType) 0.5;
+    const auto midSteps = (SampleType) mid.bitSteps, sideSteps = (SampleType) side.bitSteps;
+    const auto midWet = (SampleType) mid.wet, sideWet = (SampleType) side.wet;
+    const auto midDry = (SampleType) mid.dry, sideDry = (SampleType) side.dry;
+
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        const auto m = (left[smp] + right[smp]) * half;
+        const auto s = (left[smp] - right[smp]) * half;
+        const auto qm = std::copysign (std::ceil (std::abs (m) * midSteps) / midSteps, m);
+        const auto qs = std::copysign (std::ceil (std::abs (s) * sideSteps) / sideSteps, s);
+        const auto ym = qm * midWet + m * midDry;
+        const auto ys = qs * sideWet + s * sideDry;
+
+        left[smp] = ym + ys;
+        right[smp] = ym - ys;
+    }
+}
+
+template <typename SampleType>
+static void quantizeMixMidSideRampScalar (SampleType* left, SampleType* right, int numSamples,
+                                          const float* midSteps, const float* midWet,
+                                          const float* sideSteps, const float* sideWet) noexcept
+{
+    const auto half = (SampleType) 0.5;
+
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        const auto m = (left[smp] + right[smp]) * half;
+        const auto s = (left[smp] - right[smp]) * half;
+        const auto ms = (SampleType) midSteps[smp], ss = (SampleType) sideSteps[smp];
+        const auto mw = (SampleType) midWet[smp], sw = (SampleType) sideWet[smp];
+        const auto qm = std::copysign (std::ceil (std::abs (m) * ms) / ms, m);
+        const auto qs = std::copysign (std::ceil (std::abs (s) * ss) / ss, s);
+        const auto ym = qm * mw + m * ((SampleType) 1 - mw);
+        const auto ys = qs * sw + s * ((SampleType) 1 - sw);
+
+        left[smp] = ym + ys;
+        right[smp] = ym - ys;
+    }
+}
+
+template <typename SampleType>
+static void quantizeMixRampChannelsScalar (SampleType* const* channels, int numChannels, int numSamples,
+                                           const float* bitSteps, const float* wet) noexcept
+{
+    for (int ch = 0; ch < numChannels; ++ch)
+        quantizeMixRampScalar (channels[ch], numSamples, bitSteps, wet);
+}
+
+//==============================================================================
+/*  The dither generators for the vector loops (the *NoiseOps structs) draw the
+    noise inside the kernel: each next() steps all sixteen xorshift32 lanes once
+    and converts them exactly as DitherNoise::fill does, so every instruction set
+    gives the same noise for the same seed.
+*/
+static_assert (DitherNoise::numLanes == 16, "the generators step sixteen lanes at a time");
+
+constexpr float rectangularDitherScale = 1.f / 16777216.f;
+constexpr float triangularDitherScale = 1.f / 65536.f;
+
+/*  The vector loops, shared by every instruction set. Ops supplies the register
+    type, its width and the operations, and NoiseOps the dither generator; isa
+    is the compiler target the loops (and the Ops they inline) are built for.
+*/
+#define CRUSHER_DEFINE_VECTOR_KERNELS(suffix, OpsTemplate, NoiseOps, isa)                                           \
+    template <typename SampleType>                                                                                  \
+    CRUSHER_TARGET (isa)                                                                                            \
+    static void quantizeMix##suffix (SampleType* data, int numSamples, const Coefficients& coeffs) noexcept        \
+    {                                                                                                               \
+        using Ops = OpsTemplate<SampleType>;                                                                        \
+                                                                                                                    \
+        const auto steps = Ops::set1 ((SampleType) coeffs.bitSteps);                                               \
+        const auto wet = Ops::set1 ((SampleType) coeffs.wet);                                                      \
+        const auto dry = Ops::set1 ((SampleType) coeffs.dry);                                                      \
+                                                                                                                    \
+        int smp = 0;                                                                                                \
+                                                                                                                    \
+        for (; smp + Ops::width <= numSamples; smp += Ops::width)                                                   \
+        {                                                                                                           \
+            const auto x = Ops::load (data + smp);                                                                  \
+            const auto c = Ops::ceilPositive (Ops::mul (Ops::abs (x), steps));                                      \
+            const auto q = Ops::copySign (Ops::div (c, steps), x);                                                  \
+                                                                                                                    \
+            Ops::store (data + smp, Ops::add (Ops::mul (q, wet), Ops::mul (x, dry)));                               \
+        }                                                                                                           \
+                                                                                                                    \
+        quantizeMixScalar (data + smp, numSamples - smp, coeffs);                                                   \
+    }                                                                                                               \
+                                                                                                                    \
+    template <typename SampleType>                                                                                  \
+    CRUSHER_TARGET (isa)                                                                                            \
+    static void quantizeMixRamp##suffix (SampleType* data, int numSamples,                                          \
+                                         const float* bitSteps, const float* wet) noexcept                          \
+    {                                                                                                               \
+        using Ops = OpsTemplate<SampleType>;                                                                        \
+                                                                                                                    \
+        const auto one = Ops::set1 ((SampleType) 1);                                                                \
+                                                                                                                    \
+        int smp = 0;                                                                                                \
+                                                                                                                    \
+        for (; smp + Ops::width <= numSamples; smp += Ops::width)                                                   \
+        {                                                                                                           \
+            const auto x = Ops::load (data + smp);                                                                  \
+            const auto steps = Ops::loadParams (bitSteps + smp);                                                    \
+            const auto w = Ops::loadParams (wet + smp);                                                             \
+                                                                                                                    \
+            const auto c = Ops::ceilPositive (Ops::mul (Ops::abs (x), steps));                                      \
+            const auto q = Ops::copySign (Ops::div (c, steps), x);                                                  \
+                                                                                                                    \
+            Ops::store (data + smp, Ops::add (Ops::mul (q, w), Ops::mul (x, Ops::sub (one, w))));                   \
+        }                                                                                                           \
+                                                                                                                    \
+        quantizeMixRampScalar (data + smp, numSamples - smp, bitSteps + smp, wet + smp);                            \
+    }                                                                                                               \
+                                                                                                                    \
+    template <typename SampleType>                                                                                  \
+    CRUSHER_TARGET (isa)                                                                                            \
+    static void quantizeMixRampChannels##suffix (SampleType* const* channels, int numChannels, int numSamples,      \
+                                                 const float* bitSteps, const float* wet) noexcept                  \
+    {                                                                                                               \
+        using Ops = OpsTemplate<SampleType>;                                                                        \
+                                                                                                                    \
+        const auto one = Ops::set1 ((SampleType) 1);                                                                \
+                                                                                                                    \
+        int smp = 0;                                                                                                \
+                                                                                                                    \
+        for (; smp + Ops::width <= numSamples; smp += Ops::width)                                                   \
+        {                                                                                                           \
+            const auto steps = Ops::loadParams (bitSteps + smp);                                                    \
+            const auto w = Ops::loadParams (wet + smp);                                                             \
+            const auto dry = Ops::sub (one, w);                                                                     \
+                                                                                                                    \
+            for (int ch = 0; ch < numChannels; ++ch)                                                                \
+            {                                                                                                       \
+                const auto x = Ops::load (channels[ch] + smp);                                                      \
+                const auto c = Ops::ceilPositive (Ops::mul (Ops::abs (x), steps));                                  \
+                const auto q = Ops::copySign (Ops::div (c, steps), x);                                              \
+                                                                                                                    \
+                Ops::store (channels[ch] + smp, Ops::add (Ops::mul (q, w), Ops::mul (x, dry)));                     \
+            }                                                                                                       \
+        }                                                                                                           \
+                                                                                                                    \
+        for (int ch = 0; ch < numChannels; ++ch)                                                                    \
+            quantizeMixRampScalar (channels[ch] + smp, numSamples - smp, bitSteps + smp, wet + smp);                \
+    }                                                                                                               \
+                                                                                                                    \
+    template <typename SampleType>                                                                                  \
+    CRUSHER_TARGET (isa)                                                                                            \
+    static void quantizeMixDither##suffix (SampleType* data, int numSamples, const Coefficients& coeffs,            \
+                                           DitherNoise& noise, DitherMode mode) noexcept                            \
+    {                                                                                                               \
+        using Ops = OpsTemplate<SampleType>;                                                                        \
+        constexpr int group = DitherNoise::numLanes;                                                                \
+                                                                                                                    \
+        const auto steps = Ops::set1 ((SampleType) coeffs.bitSteps);                                               \
+        const auto wet = Ops::set1 ((SampleType) coeffs.wet);                                                      \
+        const auto dry = Ops::set1 ((SampleType) coeffs.dry);                                                      \
+        const auto triangular = mode == DitherMode::triangular;                                                     \
+        auto* lanes = noise.getLanes();                                                                             \
+        alignas (64) float values[group];                                                                           \
+                                                                                                                    \
+        int smp = 0;                                                                                                \
+                                                                                                                    \
+        for (; smp + group <= numSamples; smp += group)                                                             \
+        {                                                                                                           \
+            NoiseOps::next (lanes, values, triangular);                                                             \
+                                                                                                                    \
+            for (int i = 0; i < group; i += Ops::width)                                                             \
+            {                                                                                                       \
+                const auto x = Ops::load (data + smp + i);                                                          \
+                const auto t = Ops::add (Ops::mul (x, steps), Ops::loadParams (values + i));                        \
+                const auto q = Ops::copySign (Ops::div (Ops::ceilPositive (Ops::abs (t)), steps), t);               \
+                                                                                                                    \
+                Ops::store (data + smp + i, Ops::add (Ops::mul (q, wet), Ops::mul (x, dry)));                       \
+            }                                                                                                       \
+        }                                                                                                           \
+                                                                                                                    \
+        if (smp < numSamples)                                                                                       \
+        {                                                                                                           \
+            NoiseOps::next (lanes, values, triangular);                                                             \
+            quantizeMixNoiseScalar (data + smp, numSamples - smp, coeffs, values);                                  \
+        }                                                                                                           \
+    }                                                                                                               \
+                                                                                                                    \
+    template <typename SampleType>                                                                                  \
+    CRUSHER_TARGET (isa)                                                                                            \
+    static void quantizeMixRampDither##suffix (SampleType* data, int numSamples, const float* bitSteps,             \
+                                               const float* wet, DitherNoise& noise, DitherMode mode) noexcept      \
+    {                                                                                                               \
+        using Ops = OpsTemplate<SampleType>;                                                                        \
+        constexpr int group = DitherNoise::numLanes;                                                                \
+                                                                                                                    \
+        const auto one = Ops::set1 ((SampleType) 1);                                                                \
+        const auto triangular = mode == DitherMode::triangular;                                                     \
+        auto* lanes = noise.getLanes();                                                                             \
+        alignas (64) float values[group];                                                                           \
+                                                                                                                    \
+        int smp = 0;                                                                                                \
+                                                                                                                    \
+        for (; smp + group <= numSamples; smp += group)                                                             \
+        {                                                                                                           \
+            NoiseOps::next (lanes, values, triangular);                                                             \
+                                                                                                                    \
+            for (int i = 0; i < group; i += Ops::width)                                                             \
+            {                                                                                                       \
+                const auto x = Ops::load (data + smp + i);                                                          \
+                const auto steps = Ops::loadParams (bitSteps + smp + i);                                            \
+                const auto w = Ops::loadParams (wet + smp + i);                                                     \
+                const auto t = Ops::add (Ops::mul (x, steps), Ops::loadParams (values + i));                        \
+                const auto q = Ops::copySign (Ops::div (Ops::ceilPositive (Ops::abs (t)), steps), t);               \
+                                                                                                                    \
+                Ops::store (data + smp + i, Ops::add (Ops::mul (q, w), Ops::mul (x, Ops::sub (one, w))));           \
+            }                                                                                                       \
+        }                                                                                                           \
+                                                                                                                    \
+        if (smp < numSamples)                                                                                       \
+        {                                                                                                           \
+            NoiseOps::next (lanes, values, triangular);                                                             \
+            quantizeMixRampNoiseScalar (data + smp, numSamples - smp, bitSteps + smp, wet + smp, values);           \
+        }                                                                                                           \
+    }                                                                                                               \
+                                                                                                                    \
+    template <typename SampleType>                                                                                  \
+    CRUSHER_TARGET (isa)                                                                                            \
+    static void quantizeMixMidSide##suffix (SampleType* left, SampleType* right, int numSamples,                    \
+                                            const Coefficients& mid, const Coefficients& side) noexcept             \
+    {                                                                                                               \
+        using Ops = OpsTemplate<SampleType>;                                                                        \
+                                                                                                                    \
+        const auto half = Ops::set1 ((SampleType) 0.5);                                                             \
+        const auto midSteps = Ops::set1 ((SampleType) mid.bitSteps);                                               \
+        const auto midWet = Ops::set1 ((SampleType) mid.wet);                                                      \
+        const auto midDry = Ops::set1 ((SampleType) mid.dry);                                                      \
+        const auto sideSteps = Ops::set1 ((SampleType) side.bitSteps);                                             \
+        const auto sideWet = Ops::set1 ((SampleType) side.wet);                                                    \
+        const auto sideDry = Ops::set1 ((SampleType) side.dry);                                                    \
+                                                                                                                    \
+        int smp = 0;                                                                                                \
+                                                                                                                    \
+        for (; smp + Ops::width <= numSamples; smp += Ops::width)                                                   \
+        {                                                                                                           \
+            const auto l = Ops::load (left + smp);                                                                  \
+            const auto r = Ops::load (right + smp);                                                                 \
+            const auto m = Ops::mul (Ops::add (l, r), half);                                                        \
+            const auto s = Ops::mul (Ops::sub (l, r), half);                                                        \
+                                                                                                                    \
+            const auto qm = Ops::copySign (Ops::div (Ops::ceilPositive (Ops::mul (Ops::abs (m), midSteps)),         \
+                                                     midSteps), m);                                                 \
+            const auto qs = Ops::copySign (Ops::div (Ops::ceilPositive (Ops::mul (Ops::abs (s), sideSteps)),        \
+                                                     sideSteps), s);                                                \
+            const auto ym = Ops::add (Ops::mul (qm, midWet), Ops::mul (m, midDry));                                 \
+            const auto ys = Ops::add (Ops::mul (qs, sideWet), Ops::mul (s, sideDry));                               \
+                                                                                                                    \
+            Ops::store (left + smp, Ops::add (ym, ys));                                                             \
+            Ops::store (right + smp, Ops::sub (ym, ys));                                                            \
+        }                                                                                                           \
+                                                                                                                    \
+        quantizeMixMidSideScalar (left + smp, right + smp, numSamples - smp, mid, side);                            \
+    }                                                                                                               \
+                                                                                                                    \
+    template <typename SampleType>                                                                                  \
+    CRUSHER_TARGET (isa)                                                                                            \
+    static void quantizeMixMidSideRamp##suffix (SampleType* left, SampleType* right, int numSamples,                \
+                                                const float* midSteps, const float* midWet,                         \
+                                                const float* sideSteps, const float* sideWet) noexcept              \
+    {                                                                                                               \
+        using Ops = OpsTemplate<SampleType>;                                                                        \
+                                                                                                                    \
+        const auto one = Ops::set1 ((SampleType) 1);                                                                \
+        const auto half = Ops::set1 ((SampleType) 0.5);                                                             \
+                                                                                                                    \
+        int smp = 0;                                                                                                \
+                                                                                                                    \
+        for (; smp + Ops::width <= numSamples; smp += Ops::width)                                                   \
+        {                                                                                                           \
+            const auto l = Ops::load (left + smp);                                                                  \
+            const auto r = Ops::load (right + smp);                                                                 \
+            const auto m = Ops::mul (Ops::add (l, r), half);                                                        \
+            const auto s = Ops::mul (Ops::sub (l, r), half);                                                        \
+            const auto ms = Ops::loadParams (midSteps + smp);                                                       \
+            const auto ss = Ops::loadParams (sideSteps + smp);                                                      \
+            const auto mw = Ops::loadParams (midWet + smp);                                                         \
+            const auto sw = Ops::loadParams (sideWet + smp);                                                        \
+                                                                                                                    \
+            const auto qm = Ops::copySign (Ops::div (Ops::ceilPositive (Ops::mul (Ops::abs (m), ms)), ms), m);      \
+            const auto qs = Ops::copySign (Ops::div (Ops::ceilPositive (Ops::mul (Ops::abs (s), ss)), ss), s);      \
+            const auto ym = Ops::add (Ops::mul (qm, mw), Ops::mul (m, Ops::sub (one, mw)));                         \
+            const auto ys = Ops::add (Ops::mul (qs, sw), Ops::mul (s, Ops::sub (one, sw)));                         \
+                                                                                                                    \
+            Ops::store (left + smp, Ops::add (ym, ys));                                                             \
+            Ops::store (right + smp, Ops::sub (ym, ys));                                                            \
+        }                                                                                                           \
+                                                                                                                    \
+        quantizeMixMidSideRampScalar (left + smp, right + smp, numSamples - smp, midSteps + smp, midWet + smp,      \
+                                      sideSteps + smp, sideWet + smp);                                              \
+    }
+
+#if CRUSHER_HAS_X86_KERNELS
+//==============================================================================
+template <typename> struct SSE2Ops;
+
+template <>
+struct SSE2Ops<float>
+{
+    using Reg = __m128;
+    static constexpr int width = 4;
+
+    CRUSHER_TARGET ("sse2") static Reg load (const float* p) noexcept           { return _mm_loadu_ps (p); }
+    CRUSHER_TARGET ("sse2") static Reg loadParams (const float* p) noexcept     { return _mm_loadu_ps (p); }
+    CRUSHER_TARGET ("sse2") static void store (float* p, Reg r) noexcept        { _mm_storeu_ps (p, r); }
+    CRUSHER_TARGET ("sse2") static Reg set1 (float v) noexcept                  { return _mm_set1_ps (v); }
+    CRUSHER_TARGET ("sse2") static Reg add (Reg a, Reg b) noexcept              { return _mm_add_ps (a, b); }
+    CRUSHER_TARGET ("sse2") static Reg sub (Reg a, Reg b) noexcept              { return _mm_sub_ps (a, b); }
+    CRUSHER_TARGET ("sse2") static Reg mul (Reg a, Reg b) noexcept              { return _mm_mul_ps (a, b); }
+    CRUSHER_TARGET ("sse2") static Reg div (Reg a, Reg b) noexcept              { return _mm_div_ps (a, b); }
+    CRUSHER_TARGET ("sse2") static Reg abs (Reg a) noexcept                     { return _mm_andnot_ps (_mm_set1_ps (-0.f), a); }
+    CRUSHER_TARGET ("sse2") static Reg copySign (Reg mag, Reg src) noexcept     { return _mm_or_ps (mag, _mm_and_ps (src, _mm_set1_ps (-0.f))); }
+
+    /** SSE2 has no ceil: adding and removing 2^23 rounds to the nearest whole
+        number, which is then bumped up where it landed below. Values that are
+        already whole (everything from 2^23 on) and NaNs pass through.
+    */
+    CRUSHER_TARGET ("sse2") static Reg ceilPositive (Reg v) noexcept
+    {
+        const auto magic = _mm_set1_ps (8388608.f);
+
+        auto r = _mm_sub_ps (_mm_add_ps (v, magic), magic);
+        r = _mm_add_ps (r, _mm_and_ps (_mm_cmplt_ps (r, v), _mm_set1_ps (1.f)));
+
+        const auto inRange = _mm_cmplt_ps (v, magic);
+        return _mm_or_ps (_mm_and_ps (inRange, r), _mm_andnot_ps (inRange, v));
+    }
+};
+
+template <>
+struct SSE2Ops<double>
+{
+    using Reg = __m128d;
+    static constexpr int width = 2;
+
+    CRUSHER_TARGET ("sse2") static Reg load (const double* p) noexcept          { return _mm_loadu_pd (p); }
+    CRUSHER_TARGET ("sse2") static void store (double* p, Reg r) noexcept       { _mm_storeu_pd (p, r); }
+    CRUSHER_TARGET ("sse2") static Reg set1 (double v) noexcept                 { return _mm_set1_pd (v); }
+    CRUSHER_TARGET ("sse2") static Reg add (Reg a, Reg b) noexcept              { return _mm_add_pd (a, b); }
+    CRUSHER_TARGET ("sse2") static Reg sub (Reg a, Reg b) noexcept              { return _mm_sub_pd (a, b); }
+    CRUSHER_TARGET ("sse2") static Reg mul (Reg a, Reg b) noexcept              { return _mm_mul_pd (a, b); }
+    CRUSHER_TARGET ("sse2") static Reg div (Reg a, Reg b) noexcept              { return _mm_div_pd (a, b); }
+    CRUSHER_TARGET ("sse2") static Reg abs (Reg a) noexcept                     { return _mm_andnot_pd (_mm_set1_pd (-0.0), a); }
+    CRUSHER_TARGET ("sse2") static Reg copySign (Reg mag, Reg src) noexcept     { return _mm_or_pd (mag, _mm_and_pd (src, _mm_set1_pd (-0.0))); }
+
+    CRUSHER_TARGET ("sse2") static Reg loadParams (const float* p) noexcept
+    {
+        return _mm_cvtps_pd (_mm_castsi128_ps (_mm_loadl_epi64 (reinterpret_cast<const __m128i*> (p))));
+    }
+
+    /** Same rounding trick as the float version, with 2^52. */
+    CRUSHER_TARGET ("sse2") static Reg ceilPositive (Reg v) noexcept
+    {
+        const auto magic = _mm_set1_pd (4503599627370496.0);
+
+        auto r = _mm_sub_pd (_mm_add_pd (v, magic), magic);
+        r = _mm_add_pd (r, _mm_and_pd (_mm_cmplt_pd (r, v), _mm_set1_pd (1.0)));
+
+        const auto inRange = _mm_cmplt_pd (v, magic);
+        return _mm_or_pd (_mm_and_pd (inRange, r), _mm_andnot_pd (inRange, v));
+    }
+};
+
+//==============================================================================
+template <typename> struct AVX2Ops;
+
+template <>
+struct AVX2Ops<float>
+{
+    using Reg = __m256;
+    static constexpr int width = 8;
+
+    CRUSHER_TARGET ("avx2") static Reg load (const float* p) noexcept           { return _mm256_loadu_ps (p); }
+    CRUSHER_TARGET ("avx2") static Reg loadParams (const float* p) noexcept     { return _mm256_loadu_ps (p); }
+    CRUSHER_TARGET ("avx2") static void store (float* p, Reg r) noexcept        { _mm256_storeu_ps (p, r); }
+    CRUSHER_TARGET ("avx2") static Reg set1 (float v) noexcept                  { return _mm256_set1_ps (v); }
+    CRUSHER_TARGET ("avx2") static Reg add (Reg a, Reg b) noexcept              { return _mm256_add_ps (a, b); }
+    CRUSHER_TARGET ("avx2") static Reg sub (Reg a, Reg b) noexcept              { return _mm256_sub_ps (a, b); }
+    CRUSHER_TARGET ("avx2") static Reg mul (Reg a, Reg b) noexcept              { return _mm256_mul_ps (a, b); }
+    CRUSHER_TARGET ("avx2") static Reg div (Reg a, Reg b) noexcept              { return _mm256_div_ps (a, b); }
+    CRUSHER_TARGET ("avx2") static Reg abs (Reg a) noexcept                     { return _mm256_andnot_ps (_mm256_set1_ps (-0.f), a); }
+    CRUSHER_TARGET ("avx2") static Reg copySign (Reg mag, Reg src) noexcept     { return _mm256_or_ps (mag, _mm256_and_ps (src, _mm256_set1_ps (-0.f))); }
+    CRUSHER_TARGET ("avx2") static Reg ceilPositive (Reg v) noexcept            { return _mm256_round_ps (v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+};
+
+template <>
+struct AVX2Ops<double>
+{
+    using Reg = __m256d;
+    static constexpr int width = 4;
+
+    CRUSHER_TARGET ("avx2") static Reg load (const double* p) noexcept          { return _mm256_loadu_pd (p); }
+    CRUSHER_TARGET ("avx2") static Reg loadParams (const float* p) noexcept     { return _mm256_cvtps_pd (_mm_loadu_ps (p)); }
+    CRUSHER_TARGET ("avx2") static void store (double* p, Reg r) noexcept       { _mm256_storeu_pd (p, r); }
+    CRUSHER_TARGET ("avx2") static Reg set1 (double v) noexcept                 { return _mm256_set1_pd (v); }
+    CRUSHER_TARGET ("avx2") static Reg add (Reg a, Reg b) noexcept              { return _mm256_add_pd (a, b); }
+    CRUSHER_TARGET ("avx2") static Reg sub (Reg a, Reg b) noexcept              { return _mm256_sub_pd (a, b); }
+    CRUSHER_TARGET ("avx2") static Reg mul (Reg a, Reg b) noexcept              { return _mm256_mul_pd (a, b); }
+    CRUSHER_TARGET ("avx2") static Reg div (Reg a, Reg b) noexcept              { return _mm256_div_pd (a, b); }
+    CRUSHER_TARGET ("avx2") static Reg abs (Reg a) noexcept                     { return _mm256_andnot_pd (_mm256_set1_pd (-0.0), a); }
+    CRUSHER_TARGET ("avx2") static Reg copySign (Reg mag, Reg src) noexcept     { return _mm256_or_pd (mag, _mm256_and_pd (src, _mm256_set1_pd (-0.0))); }
+    CRUSHER_TARGET ("avx2") static Reg ceilPositive (Reg v) noexcept            { return _mm256_round_pd (v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+};
+
+//==============================================================================
+template <typename> struct AVX512Ops;
+
+template <>
+struct AVX512Ops<float>
+{
+    using Reg = __m512;
+    static constexpr int width = 16;
+
+    CRUSHER_TARGET ("avx512f") static Reg load (const float* p) noexcept        { return _mm512_loadu_ps (p); }
+    CRUSHER_TARGET ("avx512f") static Reg loadParams (const float* p) noexcept  { return _mm512_loadu_ps (p); }
+    CRUSHER_TARGET ("avx512f") static void store (float* p, Reg r) noexcept     { _mm512_storeu_ps (p, r); }
+    CRUSHER_TARGET ("avx512f") static Reg set1 (float v) noexcept               { return _mm512_set1_ps (v); }
+    CRUSHER_TARGET ("avx512f") static Reg add (Reg a, Reg b) noexcept           { return _mm512_add_ps (a, b); }
+    CRUSHER_TARGET ("avx512f") static Reg sub (Reg a, Reg b) noexcept           { return _mm512_sub_ps (a, b); }
+    CRUSHER_TARGET ("avx512f") static Reg mul (Reg a, Reg b) noexcept           { return _mm512_mul_ps (a, b); }
+    CRUSHER_TARGET ("avx512f") static Reg div (Reg a, Reg b) noexcept           { return _mm512_div_ps (a, b); }
+    CRUSHER_TARGET ("avx512f") static Reg abs (Reg a) noexcept                  { return _mm512_abs_ps (a); }
+    CRUSHER_TARGET ("avx512f") static Reg ceilPositive (Reg v) noexcept         { return _mm512_roundscale_ps (v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+
+    CRUSHER_TARGET ("avx512f") static Reg copySign (Reg mag, Reg src) noexcept
+    {
+        const auto sign = _mm512_and_si512 (_mm512_castps_si512 (src), _mm512_set1_epi32 (std::numeric_limits<int>::min()));
+        return _mm512_castsi512_ps (_mm512_or_si512 (_mm512_castps_si512 (mag), sign));
+    }
+};
+
+template <>
+struct AVX512Ops<double>
+{
+    using Reg = __m512d;
+    static constexpr int width = 8;
+
+    CRUSHER_TARGET ("avx512f") static Reg load (const double* p) noexcept       { return _mm512_loadu_pd (p); }
+    CRUSHER_TARGET ("avx512f") static Reg loadParams (const float* p) noexcept  { return _mm512_cvtps_pd (_mm256_loadu_ps (p)); }
+    CRUSHER_TARGET ("avx512f") static void store (double* p, Reg r) noexcept    { _mm512_storeu_pd (p, r); }
+    CRUSHER_TARGET ("avx512f") static Reg set1 (double v) noexcept              { return _mm512_set1_pd (v); }
+    CRUSHER_TARGET ("avx512f") static Reg add (Reg a, Reg b) noexcept           { return _mm512_add_pd (a, b); }
+    CRUSHER_TARGET ("avx512f") static Reg sub (Reg a, Reg b) noexcept           { return _mm512_sub_pd (a, b); }
+    CRUSHER_TARGET ("avx512f") static Reg mul (Reg a, Reg b) noexcept           { return _mm512_mul_pd (a, b); }
+    CRUSHER_TARGET ("avx512f") static Reg div (Reg a, Reg b) noexcept           { return _mm512_div_pd (a, b); }
+    CRUSHER_TARGET ("avx512f") static Reg abs (Reg a) noexcept                  { return _mm512_abs_pd (a); }
+    CRUSHER_TARGET ("avx512f") static Reg ceilPositive (Reg v) noexcept         { return _mm512_roundscale_pd (v, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+
+    CRUSHER_TARGET ("avx512f") static Reg copySign (Reg mag, Reg src) noexcept
+    {
+        const auto sign = _mm512_and_si512 (_mm512_castpd_si512 (src), _mm512_set1_epi64 (std::numeric_limits<long long>::min()));
+        return _mm512_castsi512_pd (_mm512_or_si512 (_mm512_castpd_si512 (mag), sign));
+    }
+};
+
+//==============================================================================
+struct SSE2NoiseOps
+{
+    using Lanes = __m128i;
+
+    CRUSHER_TARGET ("sse2") static Lanes step (Lanes x) noexcept
+    {
+        x = _mm_xor_si128 (x, _mm_slli_epi32 (x, 13));
+        x = _mm_xor_si128 (x, _mm_srli_epi32 (x, 17));
+        return _mm_xor_si128 (x, _mm_slli_epi32 (x, 5));
+    }
+
+    CRUSHER_TARGET ("sse2") static __m128 convert (Lanes x, bool triangular) noexcept
+    {
+        if (triangular)
+            return _mm_mul_ps (_mm_cvtepi32_ps (_mm_sub_epi32 (_mm_srli_epi32 (x, 16), _mm_and_si128 (x, _mm_set1_epi32 (0xffff)))),
+                               _mm_set1_ps (triangularDitherScale));
+
+        return _mm_sub_ps (_mm_mul_ps (_mm_cvtepi32_ps (_mm_srli_epi32 (x, 8)), _mm_set1_ps (rectangularDitherScale)),
+                           _mm_set1_ps (0.5f));
+    }
+
+    CRUSHER_TARGET ("sse2") static void next (juce::uint32* lanes, float* dest, bool triangular) noexcept
+    {
+        for (int i = 0; i < 16; i += 4)
+        {
+            const auto x = step (_mm_loadu_si128 ((const __m128i*) (lanes + i)));
+            _mm_storeu_si128 ((__m128i*) (lanes + i), x);
+            _mm_store_ps (dest + i, convert (x, triangular));
+        }
+    }
+};
+
+struct AVX2NoiseOps
+{
+    using Lanes = __m256i;
+
+    CRUSHER_TARGET ("avx2") static Lanes step (Lanes x) noexcept
+    {
+        x = _mm256_xor_si256 (x, _mm256_slli_epi32 (x, 13));
+        x = _mm256_xor_si256 (x, _mm256_srli_epi32 (x, 17));
+        return _mm256_xor_si256 (x, _mm256_slli_epi32 (x, 5));
+    }
+
+    CRUSHER_TARGET ("avx2") static __m256 convert (Lanes x, bool triangular) noexcept
+    {
+        if (triangular)
+            return _mm256_mul_ps (_mm256_cvtepi32_ps (_mm256_sub_epi32 (_mm256_srli_epi32 (x, 16), _mm256_and_si256 (x, _mm256_set1_epi32 (0xffff)))),
+                                  _mm256_set1_ps (triangularDitherScale));
+
+        return _mm256_sub_ps (_mm256_mul_ps (_mm256_cvtepi32_ps (_mm256_srli_epi32 (x, 8)), _mm256_set1_ps (rectangularDitherScale)),
+                              _mm256_set1_ps (0.5f));
+    }
+
+    CRUSHER_TARGET ("avx2") static void next (juce::uint32* lanes, float* dest, bool triangular) noexcept
+    {
+        const auto lo = step (_mm256_loadu_si256 ((const __m256i*) lanes));
+        const auto hi = step (_mm256_loadu_si256 ((const __m256i*) (lanes + 8)));
+
+        _mm256_storeu_si256 ((__m256i*) lanes, lo);
+        _mm256_storeu_si256 ((__m256i*) (lanes + 8), hi);
+        _mm256_store_ps (dest, convert (lo, triangular));
+        _mm256_store_ps (dest + 8, convert (hi, triangular));
+    }
+};
+
+struct AVX512NoiseOps
+{
+    CRUSHER_TARGET ("avx512f") static void next (juce::uint32* lanes, float* dest, bool triangular) noexcept
+    {
+        auto x = _mm512_loadu_si512 (lanes);
+        x = _mm512_xor_si512 (x, _mm512_slli_epi32 (x, 13));
+        x = _mm512_xor_si512 (x, _mm512_srli_epi32 (x, 17));
+        x = _mm512_xor_si512 (x, _mm512_slli_epi32 (x, 5));
+        _mm512_storeu_si512 (lanes, x);
+
+        if (triangular)
+            _mm512_store_ps (dest, _mm512_mul_ps (_mm512_cvtepi32_ps (_mm512_sub_epi32 (_mm512_srli_epi32 (x, 16), _mm512_and_si512 (x, _mm512_set1_epi32 (0xffff)))),
+                                                  _mm512_set1_ps (triangularDitherScale)));
+        else
+            _mm512_store_ps (dest, _mm512_sub_ps (_mm512_mul_ps (_mm512_cvtepi32_ps (_mm512_srli_epi32 (x, 8)), _mm512_set1_ps (rectangularDitherScale)),
+                                                  _mm512_set1_ps (0.5f)));
+    }
+};
+
+CRUSHER_DEFINE_VECTOR_KERNELS (SSE2, SSE2Ops, SSE2NoiseOps, "sse2")
+CRUSHER_DEFINE_VECTOR_KERNELS (AVX2, AVX2Ops, AVX2NoiseOps, "avx2")
+CRUSHER_DEFINE_VECTOR_KERNELS (AVX512, AVX512Ops, AVX512NoiseOps, "avx512f")
+#endif
+
+#if CRUSHER_HAS_NEON_KERNELS
+//==============================================================================
+template <typename> struct NEONOps;
+
+template <>
+struct NEONOps<float>
+{
+    using Reg = float32x4_t;
+    static constexpr int width = 4;
+
+    static Reg load (const float* p) noexcept           { return vld1q_f32 (p); }
+    static Reg loadParams (const float* p) noexcept     { return vld1q_f32 (p); }
+    static void store (float* p, Reg r) noexcept        { vst1q_f32 (p, r); }
+    static Reg set1 (float v) noexcept                  { return vdupq_n_f32 (v); }
+    static Reg add (Reg a, Reg b) noexcept              { return vaddq_f32 (a, b); }
+    static Reg sub (Reg a, Reg b) noexcept              { return vsubq_f32 (a, b); }
+    static Reg mul (Reg a, Reg b) noexcept              { return vmulq_f32 (a, b); }
+    static Reg div (Reg a, Reg b) noexcept              { return vdivq_f32 (a, b); }
+    static Reg abs (Reg a) noexcept                     { return vabsq_f32 (a); }
+    static Reg ceilPositive (Reg v) noexcept            { return vrndpq_f32 (v); }
+    static Reg copySign (Reg mag, Reg src) noexcept     { return vbslq_f32 (vdupq_n_u32 (0x80000000u), src, mag); }
+};
+
+template <>
+struct NEONOps<double>
+{
+    using Reg = float64x2_t;
+    static constexpr int width = 2;
+
+    static Reg load (const double* p) noexcept          { return vld1q_f64 (p); }
+    static Reg loadParams (const float* p) noexcept     { return vcvt_f64_f32 (vld1_f32 (p)); }
+    static void store (double* p, Reg r) noexcept       { vst1q_f64 (p, r); }
+    static Reg set1 (double v) noexcept                 { return vdupq_n_f64 (v); }
+    static Reg add (Reg a, Reg b) noexcept              { return vaddq_f64 (a, b); }
+    static Reg sub (Reg a, Reg b) noexcept              { return vsubq_f64 (a, b); }
+    static Reg mul (Reg a, Reg b) noexcept              { return vmulq_f64 (a, b); }
+    static Reg div (Reg a, Reg b) noexcept              { return vdivq_f64 (a, b); }
+    static Reg abs (Reg a) noexcept                     { return vabsq_f64 (a); }
+    static Reg ceilPositive (Reg v) noexcept            { return vrndpq_f64 (v); }
+    static Reg copySign (Reg mag, Reg src) noexcept     { return vbslq_f64 (vdupq_n_u64 (0x8000000000000000ull), src, mag); }
+};
+
+//==============================================================================
+struct NEONNoiseOps
+{
+    static void next (juce::uint32* lanes, float* dest, bool triangular) noexcept
+    {
+        for (int i = 0; i < 16; i += 4)
+        {
+            auto x = vld1q_u32 (lanes + i);
+            x = veorq_u32 (x, vshlq_n_u32 (x, 13));
+            x = veorq_u32 (x, vshrq_n_u32 (x, 17));
+            x = veorq_u32 (x, vshlq_n_u32 (x, 5));
+            vst1q_u32 (lanes + i, x);
+
+            if (triangular)
+                vst1q_f32 (dest + i, vmulq_f32 (vcvtq_f32_s32 (vsubq_s32 (vreinterpretq_s32_u32 (vshrq_n_u32 (x, 16)),
+                                                                          vreinterpretq_s32_u32 (vandq_u32 (x, vdupq_n_u32 (0xffff))))),
+                                                vdupq_n_f32 (triangularDitherScale)));
+            else
+                vst1q_f32 (dest + i, vsubq_f32 (vmulq_f32 (vcvtq_f32_u32 (vshrq_n_u32 (x, 8)), vdupq_n_f32 (rectangularDitherScale)),
+                                                vdupq_n_f32 (0.5f)));
+        }
+    }
+};
+
+CRUSHER_DEFINE_VECTOR_KERNELS (NEON, NEONOps, NEONNoiseOps, "")
+#endif
+
+#undef CRUSHER_DEFINE_VECTOR_KERNELS
+
+//==============================================================================
+template <typename SampleType>
+const Kernel<SampleType>& getScalarKernel() noexcept
+{
+    static const Kernel<SampleType> kernel { quantizeMixScalar<SampleType>, quantizeMixRampScalar<SampleType>,
+                                             quantizeMixRampChannelsScalar<SampleType>,
+                                             quantizeMixDitherScalar<SampleType>, quantizeMixRampDitherScalar<SampleType>,
+                                             quantizeMixMidSideScalar<SampleType>, quantizeMixMidSideRampScalar<SampleType>,
+                                             Isa::scalar };
+    return kernel;
+}
+
+template <typename SampleType>
+const Kernel<SampleType>& getKernel() noexcept
+{
+    using KernelType = Kernel<SampleType>;
+
+    static const KernelType kernel = []
+    {
+       #if CRUSHER_HAS_X86_KERNELS
+        if (juce::SystemStats::hasAVX512F())
+            return KernelType { quantizeMixAVX512<SampleType>, quantizeMixRampAVX512<SampleType>,
+                                 quantizeMixRampChannelsAVX512<SampleType>,
+                                 quantizeMixDitherAVX512<SampleType>, quantizeMixRampDitherAVX512<SampleType>,
+                                 quantizeMixMidSideAVX512<SampleType>, quantizeMixMidSideRampAVX512<SampleType>, Isa::avx512 };
+
+        if (juce::SystemStats::hasAVX2())
+            return KernelType { quantizeMixAVX2<SampleType>, quantizeMixRampAVX2<SampleType>,
+                                 quantizeMixRampChannelsAVX2<SampleType>,
+                                 quantizeMixDitherAVX2<SampleType>, quantizeMixRampDitherAVX2<SampleType>,
+                                 quantizeMixMidSideAVX2<SampleType>, quantizeMixMidSideRampAVX2<SampleType>, Isa::avx2 };
+
+        if (juce::SystemStats::hasSSE2())
+            return KernelType { quantizeMixSSE2<SampleType>, quantizeMixRampSSE2<SampleType>,
+                                 quantizeMixRampChannelsSSE2<SampleType>,
+                                 quantizeMixDitherSSE2<SampleType>, quantizeMixRampDitherSSE2<SampleType>,
+                                 quantizeMixMidSideSSE2<SampleType>, quantizeMixMidSideRampSSE2<SampleType>, Isa::sse2 };
+       #elif CRUSHER_HAS_NEON_KERNELS
+        return KernelType { quantizeMixNEON<SampleType>, quantizeMixRampNEON<SampleType>,
+                                 quantizeMixRampChannelsNEON<SampleType>,
+                                 quantizeMixDitherNEON<SampleType>, quantizeMixRampDitherNEON<SampleType>,
+                                 quantizeMixMidSideNEON<SampleType>, quantizeMixMidSideRampNEON<SampleType>, Isa::neon };
+       #endif
+
+        return getScalarKernel<SampleType>();
+    }();
+
+    return kernel;
+}
+
+template const Kernel<float>& getKernel<float>() noexcept;
+template const Kernel<double>& getKernel<double>() noexcept;
+template const Kernel<float>& getScalarKernel<float>() noexcept;
+template const Kernel<double>& getScalarKernel<double>() noexcept;
+
+const char* getIsaName (Isa isa) noexcept
+{
+    switch (isa)
+    {
+        case Isa::sse2:   return "SSE2";
+        case Isa::avx2:   return "AVX2";
+        case Isa::avx512: return "AVX-512";
+        case Isa::neon:   return "NEON";
+        case Isa::scalar: break;
+    }
+
+    return "Scalar";
+}
+
+} // namespace Crusher
@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+
+    Vectorized quantize-and-mix kernels for the bit crusher.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Dither.h"
+
+namespace Crusher
+{
+
+//==============================================================================
+/** How the Bit Steps value is read: as a number of steps per unit of amplitude,
+    or as a bit depth, where n bits give 2^n levels across -1..1 and so 2^(n - 1)
+    steps per unit.
+*/
+enum class StepMode
+{
+    steps,
+    bitDepth
+};
+
+/** The quantizer figures for every whole Bit Steps value in one mode, worked out
+    by the compiler so the audio thread only ever looks them up.
+*/
+struct StepTable
+{
+    static constexpr int size = 32; // Bit Steps runs from 1 to 32
+
+    std::array<float, size> steps{};
+    std::array<float, size> compensationGains{};
+};
+
+namespace detail
+{
+    constexpr double constexprSqrt (double x) noexcept
+    {
+        auto y = x > 1.0 ? x : 1.0;
+
+        for (int i = 0; i < 64; ++i)
+            y = 0.5 * (y + x / y);
+
+        return y;
+    }
+
+    constexpr StepTable makeStepTable (StepMode mode) noexcept
+    {
+        StepTable table;
+
+        for (int i = 0; i < StepTable::size; ++i)
+        {
+            const auto n = mode == StepMode::bitDepth ? (double) (1ull << i) : (double) (i + 1);
+
+            table.steps[(size_t) i] = (float) n;
+
+            // Rounding away from zero makes everything louder. Over a full-scale
+            // signal with evenly spread magnitudes, the mean square goes from 1/3
+            // to (n + 1)(2n + 1) / 6n^2; this gain undoes that
+            table.compensationGains[(size_t) i] = (float) constexprSqrt (2.0 * n * n / ((n + 1.0) * (2.0 * n + 1.0)));
+        }
+
+        return table;
+    }
+}
+
+inline constexpr std::array<StepTable, 2> stepTables { detail::makeStepTable (StepMode::steps),
+                                                       detail::makeStepTable (StepMode::bitDepth) };
+
+inline int getStepTableIndex (float bitSteps) noexcept
+{
+    return juce::jlimit (0, StepTable::size - 1, juce::roundToInt (bitSteps) - 1);
+}
+
+/** Steps per unit of amplitude for a Bit Steps value in the given mode. */
+inline float getQuantizerSteps (float bitSteps, StepMode mode) noexcept
+{
+    return stepTables[(size_t) mode].steps[(size_t) getStepTableIndex (bitSteps)];
+}
+
+/** The output gain that brings a fully wet signal back to its unquantized level. */
+inline float getCompensationGain (float bitSteps, StepMode mode) noexcept
+{
+    return stepTables[(size_t) mode].compensationGains[(size_t) getStepTableIndex (bitSteps)];
+}
+
+//==============================================================================
+/** Everything the quantizer needs for a block with steady parameters, worked out
+    once so the sample loop does no per-sample coefficient work.
+*/
+struct Coefficients
+{
+    float bitSteps{ 16.f };
+    float wet{ 0.5f }, dry{ 0.5f };
+
+    /** Takes the step count from the tables. A step count
+        off the whole-number grid (only ever seen outside the audio thread) is
+        used as is.
+    */
+    static Coefficients make (float bitSteps, float dryWetMix, StepMode mode = StepMode::steps) noexcept
+    {
+        const auto index = getStepTableIndex (bitSteps);
+
+        if (mode == StepMode::steps && bitSteps != (float) (index + 1))
+            return { bitSteps, dryWetMix, 1.f - dryWetMix };
+
+        const auto& table = stepTables[(size_t) mode];
+        return { table.steps[(size_t) index], dryWetMix, 1.f - dryWetMix };
+    }
+
+    /** newSteps is the step count the quantizer uses, i.e. after getQuantizerSteps. */
+    bool matches (float newSteps, float newDryWetMix) const noexcept
+    {
+        return bitSteps == newSteps && wet == newDryWetMix;
+    }
+};
+
+//==============================================================================
+/** Quantizes every sample away from zero onto a grid of 1 / bitSteps and blends
+    the result with the dry input, in place:
+
+        y = sign(x) * ceil(|x| * bitSteps) / bitSteps * wet + x * (1 - wet)
+*/
+template <typename SampleType>
+using QuantizeMixFn = void (*) (SampleType* data, int numSamples, const Coefficients& coeffs) noexcept;
+
+/** Same as QuantizeMixFn, but with a step count and a wet gain for every sample,
+    as produced by the parameter smoothers while they are ramping.
+*/
+template <typename SampleType>
+using QuantizeMixRampFn = void (*) (SampleType* data, int numSamples, const float* bitSteps, const float* wet) noexcept;
+
+/** QuantizeMixRampFn over several channels at once. The loop runs over time on
+    the outside and over channels on the inside, so each vector of step counts
+    and wet gains is loaded and prepared once and then used for every channel.
+*/
+template <typename SampleType>
+using QuantizeMixRampChannelsFn = void (*) (SampleType* const* channels, int numChannels, int numSamples,
+                                            const float* bitSteps, const float* wet) noexcept;
+
+/** The same two operations with dither: noise, in units of one quantizer step,
+    is added to what gets quantized but not to the dry part of the mix. The
+    kernels draw it from the generator themselves, a group of
+    DitherNoise::numLanes values at a time, so the sequence matches what
+    DitherNoise::fill would give for the same block; mode must not be off.
+*/
+template <typename SampleType>
+using QuantizeMixDitherFn = void (*) (SampleType* data, int numSamples, const Coefficients& coeffs,
+                                      DitherNoise& noise, DitherMode mode) noexcept;
+
+template <typename SampleType>
+using QuantizeMixRampDitherFn = void (*) (SampleType* data, int numSamples, const float* bitSteps, const float* wet,
+                                          DitherNoise& noise, DitherMode mode) noexcept;
+
+/** Quantizes a stereo pair in mid/side, in place. Each pair of samples is
+    encoded to mid = (l + r) / 2 and side = (l - r) / 2, each is quantized and
+    mixed with its own coefficients, and the result is decoded back to l = m + s
+    and r = m - s, all in one pass over the two channels.
+*/
+template <typename SampleType>
+using QuantizeMixMidSideFn = void (*) (SampleType* left, SampleType* right, int numSamples,
+                                       const Coefficients& mid, const Coefficients& side) noexcept;
+
+template <typename SampleType>
+using QuantizeMixMidSideRampFn = void (*) (SampleType* left, SampleType* right, int numSamples,
+                                           const float* midSteps, const float* midWet,
+                                           const float* sideSteps, const float* sideWet) noexcept;
+
+enum class Isa
+{
+    scalar,
+    sse2,
+    avx2,
+    avx512,
+    neon
+};
+
+template <typename SampleType>
+struct Kernel
+{
+    QuantizeMixFn<SampleType> quantizeMix;
+    QuantizeMixRampFn<SampleType> quantizeMixRamp;
+    QuantizeMixRampChannelsFn<SampleType> quantizeMixRampChannels;
+    QuantizeMixDitherFn<SampleType> quantizeMixDither;
+    QuantizeMixRampDitherFn<SampleType> quantizeMixRampDither;
+    QuantizeMixMidSideFn<SampleType> quantizeMixMidSide;
+    QuantizeMixMidSideRampFn<SampleType> quantizeMixMidSideRamp;
+    Isa isa;
+};
+
+/** Returns the fastest kernel the running CPU supports for float or double
+    samples. Resolved once, on first use.
+*/
+template <typename SampleType>
+const Kernel<SampleType>& getKernel() noexcept;
+
+/** The portable reference implementation, always available. */
+template <typename SampleType>
+const Kernel<SampleType>& getScalarKernel() noexcept;
+
+const char* getIsaName (Isa isa) noexcept;
+
+} // namespace Crusher
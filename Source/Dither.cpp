@@ -0,0 +1,266 @@
+/*
+  ==============================================================================
+
+    Dither and error-feedback noise shaping for the bit crusher's quantizer.
+
+  ==============================================================================
+*/
+
+#include "Dither.h"
+
+// SSE2 and NEON are part of the baseline on every target that has them, so the
+// generator needs no runtime dispatch
+#if JUCE_INTEL
+ #include <emmintrin.h>
+ #define CRUSHER_DITHER_SSE2 1
+#elif defined (__aarch64__) || defined (_M_ARM64)
+ #include <arm_neon.h>
+ #define CRUSHER_DITHER_NEON 1
+#endif
+
+namespace Crusher
+{
+
+//==============================================================================
+namespace
+{
+    // Rectangular takes the top 24 bits of a state as a uniform step; triangular
+    // takes the difference of its two 16-bit halves, which is as good as two
+    // separate draws at dither resolution and costs one
+    constexpr float rectangularScale = 1.f / 16777216.f;
+    constexpr float triangularScale = 1.f / 65536.f;
+
+   #if CRUSHER_DITHER_SSE2
+    using LaneRegister = __m128i;
+    using FloatRegister = __m128;
+
+    inline LaneRegister loadLanes (const juce::uint32* src) noexcept      { return _mm_load_si128 ((const __m128i*) src); }
+    inline void storeLanes (juce::uint32* dest, LaneRegister r) noexcept { _mm_store_si128 ((__m128i*) dest, r); }
+    inline void storeFloats (float* dest, FloatRegister r) noexcept      { _mm_storeu_ps (dest, r); }
+
+    inline void step (LaneRegister& x) noexcept
+    {
+        x = _mm_xor_si128 (x, _mm_slli_epi32 (x, 13));
+        x = _mm_xor_si128 (x, _mm_srli_epi32 (x, 17));
+        x = _mm_xor_si128 (x, _mm_slli_epi32 (x, 5));
+    }
+
+    inline FloatRegister toRectangular (LaneRegister x) noexcept
+    {
+        return _mm_sub_ps (_mm_mul_ps (_mm_cvtepi32_ps (_mm_srli_epi32 (x, 8)), _mm_set1_ps (rectangularScale)),
+                           _mm_set1_ps (0.5f));
+    }
+
+    inline FloatRegister toTriangular (LaneRegister x) noexcept
+    {
+        auto difference = _mm_sub_epi32 (_mm_srli_epi32 (x, 16), _mm_and_si128 (x, _mm_set1_epi32 (0xffff)));
+        return _mm_mul_ps (_mm_cvtepi32_ps (difference), _mm_set1_ps (triangularScale));
+    }
+   #elif CRUSHER_DITHER_NEON
+    using LaneRegister = uint32x4_t;
+    using FloatRegister = float32x4_t;
+
+    inline LaneRegister loadLanes (const juce::uint32* src) noexcept      { return vld1q_u32 (src); }
+    inline void storeLanes (juce::uint32* dest, LaneRegister r) noexcept { vst1q_u32 (dest, r); }
+    inline void storeFloats (float* dest, FloatRegister r) noexcept      { vst1q_f32 (dest, r); }
+
+    inline void step (LaneRegister& x) noexcept
+    {
+        x = veorq_u32 (x, vshlq_n_u32 (x, 13));
+        x = veorq_u32 (x, vshrq_n_u32 (x, 17));
+        x = veorq_u32 (x, vshlq_n_u32 (x, 5));
+    }
+
+    inline FloatRegister toRectangular (LaneRegister x) noexcept
+    {
+        return vsubq_f32 (vmulq_f32 (vcvtq_f32_u32 (vshrq_n_u32 (x, 8)), vdupq_n_f32 (rectangularScale)),
+                          vdupq_n_f32 (0.5f));
+    }
+
+    inline FloatRegister toTriangular (LaneRegister x) noexcept
+    {
+        auto difference = vsubq_s32 (vreinterpretq_s32_u32 (vshrq_n_u32 (x, 16)),
+                                     vreinterpretq_s32_u32 (vandq_u32 (x, vdupq_n_u32 (0xffff))));
+        return vmulq_f32 (vcvtq_f32_s32 (difference), vdupq_n_f32 (triangularScale));
+    }
+   #else
+    inline void step (juce::uint32& x) noexcept
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+    }
+
+    inline float toRectangular (juce::uint32 x) noexcept
+    {
+        return (float) (juce::int32) (x >> 8) * rectangularScale - 0.5f;
+    }
+
+    inline float toTriangular (juce::uint32 x) noexcept
+    {
+        return (float) ((juce::int32) (x >> 16) - (juce::int32) (x & 0xffff)) * triangularScale;
+    }
+   #endif
+}
+
+//==============================================================================
+DitherNoise::DitherNoise() noexcept
+{
+    seed (0);
+}
+
+void DitherNoise::seed (juce::uint32 seedValue) noexcept
+{
+    // Spread the lanes' starting points apart with a multiplicative hash; xorshift
+    // only has to avoid an all-zero state
+    for (int lane = 0; lane < numLanes; ++lane)
+    {
+        auto x = (seedValue * (juce::uint32) numLanes + (juce::uint32) lane + 1u) * 0x9E3779B9u;
+        state[(size_t) lane] = x != 0 ? x : 0x6C078965u;
+    }
+}
+
+void DitherNoise::fill (DitherMode mode, float* dest, int numSamples) noexcept
+{
+    if (mode == DitherMode::off)
+    {
+        juce::FloatVectorOperations::clear (dest, numSamples);
+        return;
+    }
+
+    const auto triangular = mode == DitherMode::triangular;
+
+   #if CRUSHER_DITHER_SSE2 || CRUSHER_DITHER_NEON
+    static_assert (numLanes == 16, "the generator runs as four registers of four lanes");
+
+    // The shifts and xors of each register are a serial chain, so four of them
+    // run interleaved to keep the pipeline full
+    auto generate = [this, dest, numSamples] (auto convert) noexcept
+    {
+        auto x0 = loadLanes (state.data());
+        auto x1 = loadLanes (state.data() + 4);
+        auto x2 = loadLanes (state.data() + 8);
+        auto x3 = loadLanes (state.data() + 12);
+
+        for (int smp = 0; smp < numSamples; smp += numLanes)
+        {
+            alignas (16) std::array<float, numLanes> values;
+            const auto complete = smp + numLanes <= numSamples;
+            auto* out = complete ? dest + smp : values.data();
+
+            step (x0);
+            step (x1);
+            step (x2);
+            step (x3);
+
+            storeFloats (out, convert (x0));
+            storeFloats (out + 4, convert (x1));
+            storeFloats (out + 8, convert (x2));
+            storeFloats (out + 12, convert (x3));
+
+            if (! complete)
+                std::copy_n (values.data(), numSamples - smp, dest + smp);
+        }
+
+        storeLanes (state.data(), x0);
+        storeLanes (state.data() + 4, x1);
+        storeLanes (state.data() + 8, x2);
+        storeLanes (state.data() + 12, x3);
+    };
+
+    if (triangular)
+        generate ([] (LaneRegister x) noexcept { return toTriangular (x); });
+    else
+        generate ([] (LaneRegister x) noexcept { return toRectangular (x); });
+   #else
+    // Every lane steps each time, as in the vector version, so both give the same sequence
+    for (int smp = 0; smp < numSamples; smp += numLanes)
+    {
+        for (int lane = 0; lane < numLanes; ++lane)
+        {
+            auto& x = state[(size_t) lane];
+            step (x);
+
+            if (smp + lane < numSamples)
+                dest[smp + lane] = triangular ? toTriangular (x) : toRectangular (x);
+        }
+    }
+   #endif
+}
+
+//==============================================================================
+namespace
+{
+    constexpr double shapingLeak = 0.6;
+
+    /** Row n holds the taps after the leading 1 of (1 - shapingLeak z^-1)^n. */
+    struct ShapingFilters
+    {
+        double taps[NoiseShaper::maxOrder + 1][NoiseShaper::maxOrder] {};
+    };
+
+    constexpr ShapingFilters makeShapingFilters()
+    {
+        ShapingFilters filters;
+        double poly[NoiseShaper::maxOrder + 1] { 1.0 };
+
+        for (int order = 1; order <= NoiseShaper::maxOrder; ++order)
+        {
+            for (int k = order; k > 0; --k)
+                poly[k] -= shapingLeak * poly[k - 1];
+
+            for (int k = 1; k <= order; ++k)
+                filters.taps[order][k - 1] = poly[k];
+        }
+
+        return filters;
+    }
+
+    constexpr auto shapingFilters = makeShapingFilters();
+}
+
+void NoiseShaper::reset() noexcept
+{
+    errors.fill (0.0);
+}
+
+template <typename SampleType>
+void NoiseShaper::process (int order, SampleType* data, int numSamples, const float* noise,
+                           const float* bitSteps, const float* wet, int stride) noexcept
+{
+    order = juce::jlimit (0, maxOrder, order);
+    const auto* taps = shapingFilters.taps[order];
+
+    for (int smp = 0, p = 0; smp < numSamples; ++smp, p += stride)
+    {
+        const auto x = (double) data[smp];
+        const auto steps = (double) bitSteps[p];
+        const auto w = (double) wet[p];
+        const auto oneStep = 1.0 / steps;
+
+        auto feedback = 0.0;
+
+        for (int k = 0; k < order; ++k)
+            feedback += taps[k] * errors[(size_t) k];
+
+        // Without these limits the filter's gain at Nyquist feeds on the
+        // quantizer's one-sided error until the output is noise far above full scale
+        const auto v = x + juce::jlimit (-oneStep, oneStep, feedback);
+        const auto limit = std::ceil (juce::jmax (1.0, std::abs (x)) * steps) / steps;
+
+        const auto d = noise != nullptr ? v + (double) noise[smp] / steps : v;
+        const auto q = juce::jlimit (-limit, limit, std::copysign (std::ceil (std::abs (d) * steps) / steps, d));
+
+        for (int k = order - 1; k > 0; --k)
+            errors[(size_t) k] = errors[(size_t) (k - 1)];
+
+        errors[0] = juce::jlimit (-oneStep, oneStep, q - v);
+
+        data[smp] = (SampleType) (q * w + x * (1.0 - w));
+    }
+}
+
+template void NoiseShaper::process<float> (int, float*, int, const float*, const float*, const float*, int) noexcept;
+template void NoiseShaper::process<double> (int, double*, int, const float*, const float*, const float*, int) noexcept;
+
+} // namespace Crusher
@@ -0,0 +1,92 @@
+/*
+  ==============================================================================
+
+    Dither and error-feedback noise shaping for the bit crusher's quantizer.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Crusher
+{
+
+enum class DitherMode
+{
+    off,
+    rectangular,
+    triangular
+};
+
+//==============================================================================
+/** Dither noise for one channel, in units of one quantizer step.
+
+    Sixteen independent xorshift32 generators run side by side in SSE2 or NEON
+    registers, so each group of sixteen values costs a handful of vector shifts
+    and xors rather than one dependent chain per sample. Every build produces
+    the same sequence for the same seed.
+
+    Rectangular dither is uniform over +/- half a step; triangular (TPDF) is the
+    difference of two uniforms and spans +/- one step.
+*/
+class DitherNoise
+{
+public:
+    static constexpr int numLanes = 16;
+
+    DitherNoise() noexcept;
+
+    /** Restarts the sequence; give every channel its own seed so they stay uncorrelated. */
+    void seed (juce::uint32 seedValue) noexcept;
+
+    /** Fills dest with numSamples values of the given kind, or zeros when off. */
+    void fill (DitherMode mode, float* dest, int numSamples) noexcept;
+
+    /** The generators' states, for the quantizer kernels that draw their noise
+        inline. They must step every lane once per group of numLanes samples, a
+        partial group included, and convert as fill does.
+    */
+    juce::uint32* getLanes() noexcept { return state.data(); }
+
+private:
+    alignas (16) std::array<juce::uint32, numLanes> state;
+};
+
+//==============================================================================
+/** Error-feedback noise shaping around the quantize-and-mix curve, for one channel.
+
+    The error each sample's quantization made (dither included) is fed back
+    through the filter (1 - 0.6 z^-1)^order and added to the following samples,
+    which pushes the quantization noise up towards Nyquist: each order takes
+    another 8 dB off the low end and adds 4 dB at the top, so the peak gain is
+    1.6^order, about 37 dB (69x) at the ninth. The quantizer's error is always
+    away from zero and never averages out, so that gain alone would let the
+    loop run away at coarse settings; the feedback and the stored errors are
+    held to one step either way, and the wet output never goes past full scale
+    or the plain quantizer's level for the same input, whichever is higher.
+
+    The feedback makes every sample depend on the previous ones, so this runs
+    one sample at a time, with the filter state in double for either precision.
+*/
+class NoiseShaper
+{
+public:
+    static constexpr int maxOrder = 9;
+
+    void reset() noexcept;
+
+    /** Processes one channel in place. noise is per-sample dither in steps, or
+        nullptr for none; bitSteps and wet are read with the given stride, so a
+        stride of 0 holds them constant over the whole block.
+    */
+    template <typename SampleType>
+    void process (int order, SampleType* data, int numSamples, const float* noise,
+                  const float* bitSteps, const float* wet, int stride) noexcept;
+
+private:
+    std::array<double, maxOrder> errors{}; // most recent first
+};
+
+} // namespace Crusher
@@ -0,0 +1,156 @@
+/*
+  ==============================================================================
+
+    Level and quantization-error metering, handed from the audio thread to the
+    editor without locks.
+
+  ==============================================================================
+*/
+
+#include "Metering.h"
+
+namespace Crusher
+{
+
+//==============================================================================
+bool MeterFifo::push (const MeterFrame& frame) noexcept
+{
+    const auto scope = fifo.write (1);
+
+    if (scope.blockSize1 > 0)
+        frames[(size_t) scope.startIndex1] = frame;
+    else if (scope.blockSize2 > 0)
+        frames[(size_t) scope.startIndex2] = frame;
+    else
+        return false;
+
+    return true;
+}
+
+bool MeterFifo::pop (MeterFrame& frame) noexcept
+{
+    const auto scope = fifo.read (1);
+
+    if (scope.blockSize1 > 0)
+        frame = frames[(size_t) scope.startIndex1];
+    else if (scope.blockSize2 > 0)
+        frame = frames[(size_t) scope.startIndex2];
+    else
+        return false;
+
+    return true;
+}
+
+//==============================================================================
+namespace
+{
+    template <typename SampleType, typename Level>
+    void accumulate (Level& level, const SampleType* data, size_t numSamples) noexcept
+    {
+        auto sum = 0.0;
+        auto peak = level.peak;
+
+        for (size_t smp = 0; smp < numSamples; ++smp)
+        {
+            const auto x = (double) data[smp];
+            sum += x * x;
+            peak = juce::jmax (peak, (float) std::abs (x));
+        }
+
+        level.sumOfSquares += sum;
+        level.numValues += (double) numSamples;
+        level.peak = peak;
+    }
+}
+
+void BlockMeter::prepare (int numChannels, int maxBlockSize)
+{
+    maxSamples = (size_t) maxBlockSize;
+    dryCopy.assign ((size_t) numChannels * maxSamples, 0.0);
+    reset();
+}
+
+void BlockMeter::reset() noexcept
+{
+    input = {};
+    output = {};
+    error = {};
+    dryChannels = drySamples = 0;
+}
+
+template <typename SampleType>
+void BlockMeter::measureInput (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+        accumulate (input, block.getChannelPointer (channel), block.getNumSamples());
+}
+
+template <typename SampleType>
+void BlockMeter::measureOutput (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+        accumulate (output, block.getChannelPointer (channel), block.getNumSamples());
+}
+
+template <typename SampleType>
+void BlockMeter::captureDry (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    drySamples = juce::jmin (block.getNumSamples(), maxSamples);
+    dryChannels = maxSamples > 0 ? juce::jmin (block.getNumChannels(), dryCopy.size() / maxSamples) : 0;
+
+    for (size_t channel = 0; channel < dryChannels; ++channel)
+    {
+        const auto* src = block.getChannelPointer (channel);
+        auto* dest = dryCopy.data() + channel * maxSamples;
+
+        for (size_t smp = 0; smp < drySamples; ++smp)
+            dest[smp] = (double) src[smp];
+    }
+}
+
+template <typename SampleType>
+void BlockMeter::measureError (const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    for (size_t channel = 0; channel < juce::jmin (dryChannels, block.getNumChannels()); ++channel)
+    {
+        const auto* wet = block.getChannelPointer (channel);
+        const auto* dry = dryCopy.data() + channel * maxSamples;
+        auto sum = 0.0;
+
+        for (size_t smp = 0; smp < drySamples; ++smp)
+        {
+            const auto e = (double) wet[smp] - dry[smp];
+            sum += e * e;
+        }
+
+        error.sumOfSquares += sum;
+        error.numValues += (double) drySamples;
+    }
+
+    dryChannels = drySamples = 0;
+}
+
+MeterFrame BlockMeter::finishFrame() noexcept
+{
+    MeterFrame frame;
+
+    frame.inputPeak = input.peak;
+    frame.inputRms = input.getRms();
+    frame.outputPeak = output.peak;
+    frame.outputRms = output.getRms();
+    frame.errorRms = error.getRms();
+
+    reset();
+    return frame;
+}
+
+template void BlockMeter::measureInput<float> (const juce::dsp::AudioBlock<float>&) noexcept;
+template void BlockMeter::measureInput<double> (const juce::dsp::AudioBlock<double>&) noexcept;
+template void BlockMeter::measureOutput<float> (const juce::dsp::AudioBlock<float>&) noexcept;
+template void BlockMeter::measureOutput<double> (const juce::dsp::AudioBlock<double>&) noexcept;
+template void BlockMeter::captureDry<float> (const juce::dsp::AudioBlock<float>&) noexcept;
+template void BlockMeter::captureDry<double> (const juce::dsp::AudioBlock<double>&) noexcept;
+template void BlockMeter::measureError<float> (const juce::dsp::AudioBlock<float>&) noexcept;
+template void BlockMeter::measureError<double> (const juce::dsp::AudioBlock<double>&) noexcept;
+
+} // namespace Crusher
@@ -0,0 +1,91 @@
+/*
+  ==============================================================================
+
+    Level and quantization-error metering, handed from the audio thread to the
+    editor without locks.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Crusher
+{
+
+//==============================================================================
+/** One processBlock call worth of levels, as linear gains. */
+struct MeterFrame
+{
+    float inputPeak{ 0.f }, inputRms{ 0.f };
+    float outputPeak{ 0.f }, outputRms{ 0.f };
+    float errorRms{ 0.f }; // what the crusher added: output of the quantizer minus its input
+};
+
+//==============================================================================
+/** A fixed-size single-producer, single-consumer queue of meter frames.
+
+    The audio thread pushes, the message thread pops. Neither side ever locks or
+    allocates; if the reader falls behind (editor closed, message thread busy)
+    new frames are simply dropped.
+*/
+class MeterFifo
+{
+public:
+    static constexpr int capacity = 128;
+
+    bool push (const MeterFrame& frame) noexcept;
+    bool pop (MeterFrame& frame) noexcept;
+
+private:
+    juce::AbstractFifo fifo { capacity };
+    std::array<MeterFrame, capacity> frames;
+};
+
+//==============================================================================
+/** Accumulates the levels for one frame on the audio thread.
+
+    Input and output are measured on the host buffer. The quantization error is
+    measured around the crusher itself, at the processing rate, by keeping a copy
+    of each sub-block before it is crushed and comparing afterwards; the copy
+    lives in memory reserved by prepare.
+*/
+class BlockMeter
+{
+public:
+    void prepare (int numChannels, int maxBlockSize);
+    void reset() noexcept;
+
+    template <typename SampleType>
+    void measureInput (const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    template <typename SampleType>
+    void measureOutput (const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    template <typename SampleType>
+    void captureDry (const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    template <typename SampleType>
+    void measureError (const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    /** Returns everything measured since the last call and starts a new frame. */
+    MeterFrame finishFrame() noexcept;
+
+private:
+    struct Level
+    {
+        double sumOfSquares = 0.0;
+        double numValues = 0.0;
+        float peak = 0.f;
+
+        float getRms() const noexcept   { return numValues > 0.0 ? (float) std::sqrt (sumOfSquares / numValues) : 0.f; }
+    };
+
+    std::vector<double> dryCopy;
+    size_t dryChannels = 0, drySamples = 0, maxSamples = 0;
+
+    Level input, output, error;
+};
+
+} // namespace Crusher
@@ -0,0 +1,168 @@
+/*
+  ==============================================================================
+
+    LFOs and an envelope follower that modulate the crusher at audio rate.
+
+  ==============================================================================
+*/
+
+#include "Modulation.h"
+
+namespace Crusher
+{
+
+void multiplyByExp2 (float* dest, const float* source, float scale, int numSamples) noexcept
+{
+    // Biased so the exponent is positive and truncation rounds down
+    constexpr float bias = 64.f;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        const auto x = scale * source[i] + bias;
+        const auto whole = (int) x;
+        const auto f = x - (float) whole;
+
+        // 2^f on 0..1, minimax fit
+        const auto fraction = 1.f + f * (0.693147f + f * (0.240160f + f * (0.0558282f + f * (0.00898934f + f * 0.00187757f))));
+
+        const auto bits = (juce::uint32) (whole - (int) bias + 127) << 23;
+        float power;
+        std::memcpy (&power, &bits, sizeof (float));
+
+        dest[i] *= fraction * power;
+    }
+}
+
+void Lfo::setSampleRate (double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+}
+
+void Lfo::reset() noexcept
+{
+    phase = 0.0;
+    currentValue = random.nextFloat() * 2.f - 1.f;
+    nextValue = random.nextFloat() * 2.f - 1.f;
+}
+
+template <typename ShapeFn>
+void Lfo::render (float rateHz, float* dest, int numSamples, ShapeFn&& shape) noexcept
+{
+    const auto increment = juce::jmax (0.0, (double) rateHz / sampleRate);
+
+    for (int start = 0; start < numSamples;)
+    {
+        // Samples left before the phase wraps, so the inner loop never has to check
+        auto untilWrap = increment > 0.0 ? (int) std::ceil ((1.0 - phase) / increment) : numSamples;
+        auto end = juce::jmin (numSamples, start + juce::jmax (1, untilWrap));
+
+        shape (dest + start, end - start, (float) phase, (float) increment);
+        phase += increment * (end - start);
+
+        if (phase >= 1.0)
+        {
+            phase -= std::floor (phase);
+            currentValue = nextValue;
+            nextValue = random.nextFloat() * 2.f - 1.f;
+        }
+
+        start = end;
+    }
+}
+
+void Lfo::process (LfoShape shape, float rateHz, float* dest, int numSamples) noexcept
+{
+    switch (shape)
+    {
+        case LfoShape::sine:
+            render (rateHz, dest, numSamples, [] (float* out, int count, float startPhase, float increment)
+            {
+                // A parabola per half cycle with one correction term, within 0.1 % of a sine
+                for (int i = 0; i < count; ++i)
+                {
+                    auto t = 2.f * (startPhase + (float) i * increment) - 1.f;
+                    auto y = 4.f * t * (1.f - std::abs (t));
+                    out[i] = -(0.225f * (y * std::abs (y) - y) + y);
+                }
+            });
+            break;
+
+        case LfoShape::triangle:
+            render (rateHz, dest, numSamples, [] (float* out, int count, float startPhase, float increment)
+            {
+                for (int i = 0; i < count; ++i)
+                    out[i] = 1.f - 4.f * std::abs (startPhase + (float) i * increment - 0.5f);
+            });
+            break;
+
+        case LfoShape::sampleAndHold:
+            render (rateHz, dest, numSamples, [this] (float* out, int count, float, float)
+            {
+                juce::FloatVectorOperations::fill (out, currentValue, count);
+            });
+            break;
+
+        case LfoShape::random:
+        default:
+            render (rateHz, dest, numSamples, [this] (float* out, int count, float startPhase, float increment)
+            {
+                const auto from = currentValue, range = nextValue - currentValue;
+
+                for (int i = 0; i < count; ++i)
+                    out[i] = from + range * (startPhase + (float) i * increment);
+            });
+            break;
+    }
+}
+
+//==============================================================================
+void EnvelopeFollower::setSampleRate (double newSampleRate) noexcept
+{
+    sampleRate = newSampleRate;
+}
+
+void EnvelopeFollower::reset() noexcept
+{
+    level = 0.f;
+}
+
+float EnvelopeFollower::getCoefficient (float timeMs) const noexcept
+{
+    // Reaches 1 - 1/e of the way in the given time
+    return 1.f - std::exp (-1.f / juce::jmax (1.f, timeMs * 0.001f * (float) sampleRate));
+}
+
+template <typename SampleType>
+void EnvelopeFollower::process (const juce::dsp::AudioBlock<SampleType>& block, float attackMs, float releaseMs, float* dest) noexcept
+{
+    const auto numSamples = (int) block.getNumSamples();
+
+    juce::FloatVectorOperations::clear (dest, numSamples);
+
+    for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+    {
+        const auto* data = block.getChannelPointer (channel);
+
+        // max (a, b) written without a compare, so the loop vectorizes
+        for (int smp = 0; smp < numSamples; ++smp)
+        {
+            const auto magnitude = (float) std::abs (data[smp]);
+            dest[smp] = 0.5f * (dest[smp] + magnitude + std::abs (dest[smp] - magnitude));
+        }
+    }
+
+    const auto attack = getCoefficient (attackMs);
+    const auto release = getCoefficient (releaseMs);
+
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        const auto peak = juce::jmin (1.f, dest[smp]);
+        level += (peak > level ? attack : release) * (peak - level);
+        dest[smp] = level;
+    }
+}
+
+template void EnvelopeFollower::process<float> (const juce::dsp::AudioBlock<float>&, float, float, float*) noexcept;
+template void EnvelopeFollower::process<double> (const juce::dsp::AudioBlock<double>&, float, float, float*) noexcept;
+
+} // namespace Crusher
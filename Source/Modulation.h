@@ -0,0 +1,87 @@
+/*
+  ==============================================================================
+
+    LFOs and an envelope follower that modulate the crusher at audio rate.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Crusher
+{
+
+enum class LfoShape
+{
+    sine,
+    triangle,
+    sampleAndHold,
+    random
+};
+
+enum class ModSource
+{
+    off,
+    lfo1,
+    lfo2,
+    envelope
+};
+
+/** dest[i] *= 2 ^ (scale * source[i]). The exponents must stay within +/- 60.
+    A polynomial stands in for exp2 (within 0.001 %), so the loop vectorizes. */
+void multiplyByExp2 (float* dest, const float* source, float scale, int numSamples) noexcept;
+
+//==============================================================================
+/** A free-running LFO producing -1..1, one whole block at a time.
+
+    The block is split where the phase wraps, so inside each piece the phase is
+    just a straight line and every shape is a short branch-free loop over it
+    that the compiler vectorizes. Sample and hold takes a new random value at
+    every wrap; random glides linearly from one random value to the next.
+*/
+class Lfo
+{
+public:
+    /** Keeps the phase, so it can be called again when the oversampling changes. */
+    void setSampleRate (double newSampleRate) noexcept;
+    void reset() noexcept;
+
+    void process (LfoShape shape, float rateHz, float* dest, int numSamples) noexcept;
+
+private:
+    template <typename ShapeFn>
+    void render (float rateHz, float* dest, int numSamples, ShapeFn&& shape) noexcept;
+
+    double sampleRate = 44100.0;
+    double phase = 0.0;
+    float currentValue = 0.f, nextValue = 0.f; // the random targets, drawn at each wrap
+    juce::Random random;
+};
+
+//==============================================================================
+/** Follows the peak level of all channels together, with separate attack and
+    release times, as a 0..1 signal.
+
+    Taking the peak across channels is vectorized; the one-pole smoothing that
+    follows is inherently sequential, but it is only a couple of operations a
+    sample and is shared by every channel.
+*/
+class EnvelopeFollower
+{
+public:
+    void setSampleRate (double newSampleRate) noexcept;
+    void reset() noexcept;
+
+    template <typename SampleType>
+    void process (const juce::dsp::AudioBlock<SampleType>& block, float attackMs, float releaseMs, float* dest) noexcept;
+
+private:
+    float getCoefficient (float timeMs) const noexcept;
+
+    double sampleRate = 44100.0;
+    float level = 0.f;
+};
+
+} // namespace Crusher
@@ -24,61 +24,80 @@ void LookAndFeel::drawRotarySlider(juce::Graphics& g,
 
     auto bounds = Rectangle<float>(x, y, width, height);
 
-    auto enabled = slider.isEnabled();
-
-    g.setColour(enabled ? Colour(255u, 126u, 13u) : Colours::darkgrey); //apka Digital Color Meter
-    g.fillEllipse(bounds);
-
-    g.setColour(enabled ? Colour(207u, 34u, 0u) : Colours::grey);
-    g.drawEllipse(bounds, 2.f);
+    drawRotarySliderBody(g, bounds, slider.isEnabled());
 
     if (auto* rswl = dynamic_cast<RotarySliderWithLabels*>(&slider))
     {
-        auto center = bounds.getCentre();
+        jassert(rotaryStartAngle < rotaryEndAngle);
 
-        Path p;
+        auto sliderAngRad = jmap(sliderPosProportional, 0.f, 1.f, rotaryStartAngle, rotaryEndAngle); //zmapowanie wartosci radionow pomiedzy granice rotary slidera
 
-        Rectangle<float> r;
-        r.setLeft(center.getX() - 2);
-        r.setRight(center.getX() + 2);
-        r.setTop(bounds.getY());
-        r.setBottom(center.getY() - rswl->getTextHeight() * 1.5);
+        drawRotarySliderPointer(g, bounds, sliderAngRad, *rswl);
+    }
+}
 
-        p.addRoundedRectangle(r, 2.f);
+void LookAndFeel::drawRotarySliderBody(juce::Graphics& g, juce::Rectangle<float> bounds, bool enabled)
+{
+    using namespace juce;
 
-        jassert(rotaryStartAngle < rotaryEndAngle);
+    g.setColour(enabled ? Colour(255u, 126u, 13u) : Colours::darkgrey); //apka Digital Color Meter
+    g.fillEllipse(bounds);
 
-        auto sliderAngRad = jmap(sliderPosProportional, 0.f, 1.f, rotaryStartAngle, rotaryEndAngle); //zmapowanie wartosci radionow pomiedzy granice rotary slidera
+    g.setColour(enabled ? Colour(207u, 34u, 0u) : Colours::grey);
+    g.drawEllipse(bounds, 2.f);
+}
 
-        p.applyTransform(AffineTransform().rotated(sliderAngRad, center.getX(), center.getY()));
+void LookAndFeel::drawRotarySliderPointer(juce::Graphics& g, juce::Rectangle<float> bounds, float angle,
+                                          RotarySliderWithLabels& rswl)
+{
+    using namespace juce;
 
-        g.fillPath(p);
+    auto enabled = rswl.isEnabled();
+    auto center = bounds.getCentre();
 
-        g.setFont(rswl->getTextHeight());
-        auto text = rswl->getDisplayString();
-        auto strWidth = g.getCurrentFont().getStringWidth(text);
+    Rectangle<float> r;
+    r.setLeft(center.getX() - 2);
+    r.setRight(center.getX() + 2);
+    r.setTop(bounds.getY());
+    r.setBottom(center.getY() - rswl.getTextHeight() * 1.5);
 
-        r.setSize(strWidth + 4, rswl->getTextHeight() + 2);
-        r.setCentre(center);
+    // The pointer is a rounded bar, so rotating the graphics context is all it takes;
+    // no Path is built per repaint
+    {
+        Graphics::ScopedSaveState state(g);
+        g.addTransform(AffineTransform::rotation(angle, center.getX(), center.getY()));
+        g.setColour(enabled ? Colour(207u, 34u, 0u) : Colours::grey);
+        g.fillRoundedRectangle(r, 2.f);
+    }
 
-        g.setColour(enabled ? Colours::black : Colours::darkgrey);
-        g.fillRect(r);
+    g.setFont(rswl.getTextHeight());
+    auto text = rswl.getDisplayString();
+    auto strWidth = g.getCurrentFont().getStringWidth(text);
 
-        g.setColour(enabled ? Colours::white : Colours::lightgrey);
-        g.drawFittedText(text, r.toNearestInt(), juce::Justification::centred, 1);
-    }
+    r.setSize(strWidth + 4, rswl.getTextHeight() + 2);
+    r.setCentre(center);
+
+    g.setColour(enabled ? Colours::black : Colours::darkgrey);
+    g.fillRect(r);
+
+    g.setColour(enabled ? Colours::white : Colours::lightgrey);
+    g.drawFittedText(text, r.toNearestInt(), juce::Justification::centred, 1);
 }
 
 void LookAndFeel::drawToggleButton(juce::Graphics& g,
     juce::ToggleButton& toggleButton,
     bool shouldDrawButtonAsHighlighted,
     bool shouldDrawButtonAsDown)
+{
+    drawPowerGlyph(g, toggleButton.getLocalBounds(), toggleButton.getToggleState());
+}
+
+void LookAndFeel::drawPowerGlyph(juce::Graphics& g, juce::Rectangle<int> bounds, bool on)
 {
     using namespace juce;
 
     Path powerButton;
 
-    auto bounds = toggleButton.getLocalBounds();
     auto size = jmin(bounds.getWidth(), bounds.getHeight()) - 80;
     auto r = bounds.withSizeKeepingCentre(size, size).toFloat();
 
@@ -99,33 +118,115 @@ void LookAndFeel::drawToggleButton(juce::Graphics& g,
 
     PathStrokeType pst(2.f, PathStrokeType::JointStyle::curved);
 
-    auto color = toggleButton.getToggleState() ?  Colour(207u, 34u, 0u) : Colours::dimgrey;
+    auto color = on ?  Colour(207u, 34u, 0u) : Colours::dimgrey;
 
     g.setColour(color);
     g.strokePath(powerButton, pst);
     g.drawEllipse(r, 2);
 }
 
-void RotarySliderWithLabels::paint(juce::Graphics& g)
+//==============================================================================
+template <typename RenderFn>
+juce::Image SharedEditorResources::getAsset(const AssetKey& key, RenderFn&& render)
 {
     using namespace juce;
 
-    auto startAng = degreesToRadians(180.f + 55.f);
-    auto endAng = degreesToRadians(180.f - 55.f) + MathConstants<float>::twoPi;
+    auto found = assets.find(key);
+
+    if (found != assets.end())
+        return found->second;
+
+    if (assets.size() >= maxAssets)
+        assets.clear();
+
+    Image image(Image::ARGB, jmax(1, roundToInt(key.width * key.scale)), jmax(1, roundToInt(key.height * key.scale)), true);
+
+    {
+        Graphics g(image);
+        g.addTransform(AffineTransform::scale(key.scale));
+        render(g);
+    }
+
+    assets.emplace(key, image);
+    return image;
+}
+
+juce::Image SharedEditorResources::getKnobBody(int diameter, float scale, bool enabled)
+{
+    return getAsset({ 0, diameter + 4, diameter + 4, enabled ? 1 : 0, scale }, [&](juce::Graphics& g)
+    {
+        lookAndFeel.drawRotarySliderBody(g, { 2.f, 2.f, (float) diameter, (float) diameter }, enabled);
+    });
+}
+
+juce::Image SharedEditorResources::getPowerGlyph(int width, int height, float scale, bool on)
+{
+    return getAsset({ 1, width, height, on ? 1 : 0, scale }, [&](juce::Graphics& g)
+    {
+        lookAndFeel.drawPowerGlyph(g, { width, height }, on);
+    });
+}
+
+//==============================================================================
+void RotarySliderWithLabels::paint(juce::Graphics& g)
+{
+    using namespace juce;
 
     auto range = getRange();
 
     auto sliderBounds = getSliderBounds();
 
-    getLookAndFeel().drawRotarySlider(g,
-        sliderBounds.getX(),
-        sliderBounds.getY(),
-        sliderBounds.getWidth(),
-        sliderBounds.getHeight(),
-        jmap(getValue(), range.getStart(), range.getEnd(), 0.0, 1.0),
-        startAng,
-        endAng,
-        *this);
+    // Body and ring only change with size, scale or enablement, so they come from a
+    // cached layer, and the labels are painted by labelsComponent; only the pointer
+    // and the value text are drawn each time
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    g.drawImage(resources->getKnobBody(sliderBounds.getWidth(), scale, isEnabled()), getLocalBounds().toFloat());
+
+    auto sliderAngRad = jmap((float) jmap(getValue(), range.getStart(), range.getEnd(), 0.0, 1.0), 0.f, 1.f, startAng, endAng);
+
+    resources->lookAndFeel.drawRotarySliderPointer(g, sliderBounds.toFloat(), sliderAngRad, *this);
+}
+
+void RotarySliderWithLabels::setLabelledBounds(juce::Rectangle<int> area)
+{
+    auto size = juce::jmin(area.getWidth(), area.getHeight());
+
+    size -= getTextHeight() * 2;
+    juce::Rectangle<int> r;
+    r.setSize(size, size);
+    r.setCentre(area.getCentreX(), 0);
+    r.setY(area.getY() + 2);
+
+    labelsComponent.setBounds(area);
+    setBounds(r.expanded(2)); // the ring's margin
+    labelLayer = {};
+}
+
+void RotarySliderWithLabels::paintLabels(juce::Graphics& g)
+{
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    if (labelLayer.isNull() || scale != labelScale)
+        renderLabels(scale);
+
+    g.drawImage(labelLayer, labelsComponent.getLocalBounds().toFloat());
+}
+
+void RotarySliderWithLabels::renderLabels(float scale)
+{
+    using namespace juce;
+
+    auto bounds = labelsComponent.getLocalBounds();
+
+    labelScale = scale;
+    labelLayer = Image(Image::ARGB, jmax(1, roundToInt(bounds.getWidth() * scale)),
+                                    jmax(1, roundToInt(bounds.getHeight() * scale)), true);
+
+    Graphics g(labelLayer);
+    g.addTransform(AffineTransform::scale(scale));
+
+    auto sliderBounds = getSliderBounds() + getPosition() - labelsComponent.getPosition();
 
     auto center = sliderBounds.toFloat().getCentre();
     auto radius = sliderBounds.getWidth() * 0.5f;
@@ -147,13 +248,13 @@ void RotarySliderWithLabels::paint(juce::Graphics& g)
         auto str = labels[i].label;
 
         if (labels[i].pos == 1.22f) {
-            g.setFont(getTextHeight() + 1);
+            g.setFont(resources->captionFont);
             r.setSize(g.getCurrentFont().getStringWidthFloat(str), getTextHeight() - 6);
             r.setCentre(c);
             r.setY(r.getY() + getTextHeight() - 6);
         }
         else {
-            g.setFont(getTextHeight() - 2);
+            g.setFont(resources->labelFont);
             r.setSize(g.getCurrentFont().getStringWidthFloat(str), getTextHeight() + 2);
             r.setCentre(c);
             r.setY(r.getY() + getTextHeight() + 2);
@@ -165,18 +266,8 @@ void RotarySliderWithLabels::paint(juce::Graphics& g)
 
 juce::Rectangle<int> RotarySliderWithLabels::getSliderBounds() const
 {
-    //return getLocalBounds();
-    auto bounds = getLocalBounds();
-
-    auto size = juce::jmin(bounds.getWidth(), bounds.getHeight());
-
-    size -= getTextHeight() * 2;
-    juce::Rectangle<int> r;
-    r.setSize(size, size);
-    r.setCentre(bounds.getCentreX(), 0);
-    r.setY(2);
-
-    return r;
+    // setLabelledBounds leaves just the ring's margin around the knob
+    return getLocalBounds().reduced(2);
 }
 
 juce::String RotarySliderWithLabels::getDisplayString() const
@@ -307,12 +398,13 @@ void PowerButton::paint(juce::Graphics& g)
 {
     using namespace juce;
 
-    auto buttonBounds = getButtonBounds();
+    // The glyph is shared artwork; the button only repaints on a toggle, so the caption
+    // is cheap to draw directly
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
 
-    getLookAndFeel().drawToggleButton(g,
-        *this,
-        true,
-        true);
+    g.drawImage(resources->getPowerGlyph(getWidth(), getHeight(), scale, getToggleState()), getLocalBounds().toFloat());
+
+    auto buttonBounds = getButtonBounds();
 
     auto center = buttonBounds.toFloat().getCentre();
     auto radius = buttonBounds.getWidth() * 0.5f;
@@ -327,7 +419,7 @@ void PowerButton::paint(juce::Graphics& g)
         Rectangle<float> r;
         auto str = names[i].name;
 
-        g.setFont(getTextHeight());
+        g.setFont(resources->valueFont);
         r.setSize(g.getCurrentFont().getStringWidthFloat(str), getTextHeight());
         r.setCentre(c);
         r.setY(r.getY() + getTextHeight() - 20);
@@ -351,6 +443,293 @@ juce::Rectangle<int> PowerButton::getButtonBounds() const
     return r;
 }
 
+void LevelMeter::setLevels(float rms, float peak)
+{
+    auto newRms = juce::jmax(minDecibels, juce::Decibels::gainToDecibels(rms, minDecibels));
+    auto newPeak = juce::jmax(minDecibels, juce::Decibels::gainToDecibels(peak, minDecibels));
+
+    // Anything under a tenth of a dB is less than a pixel
+    if (std::abs(newRms - rmsDecibels) < 0.1f && std::abs(newPeak - peakDecibels) < 0.1f)
+        return;
+
+    rmsDecibels = newRms;
+    peakDecibels = newPeak;
+    repaint();
+}
+
+void LevelMeter::paint(juce::Graphics& g)
+{
+    using namespace juce;
+
+    auto bounds = getLocalBounds().toFloat();
+
+    g.fillAll(Colours::black);
+
+    g.setColour(Colours::dimgrey);
+    g.drawRect(bounds, 1.f);
+
+    auto inner = bounds.reduced(2.f);
+    auto rmsY = jmap(rmsDecibels, minDecibels, 0.f, inner.getBottom(), inner.getY());
+    auto peakY = jmap(peakDecibels, minDecibels, 0.f, inner.getBottom(), inner.getY());
+
+    g.setColour(Colour(255u, 126u, 13u));
+    g.fillRect(inner.withTop(rmsY));
+
+    g.setColour(Colour(207u, 34u, 0u));
+    g.fillRect(inner.getX(), peakY, inner.getWidth(), 2.f);
+}
+
+void ScopeDisplay::paint(juce::Graphics& g)
+{
+    using namespace juce;
+
+    g.fillAll(Colours::black);
+
+    auto bounds = getLocalBounds();
+    auto height = (float) bounds.getHeight();
+    auto width = (int) inputColumns.size();
+
+    g.setColour(Colours::dimgrey);
+    g.drawRect(bounds, 1);
+    g.fillRect(0.f, height * 0.5f, (float) width, 1.f);
+
+    auto toY = [height](float value) { return jmap(jlimit(-1.f, 1.f, value), 1.f, -1.f, 1.f, height - 1.f); };
+
+    auto drawColumns = [&](const std::vector<Crusher::ScopePyramid::Range>& columns, int numColumns)
+    {
+        // Newest on the right; columns without history yet stay empty on the left
+        auto x = width - numColumns;
+
+        for (int i = 0; i < numColumns; ++i, ++x)
+        {
+            auto top = toY(columns[(size_t) i].max);
+            auto bottom = toY(columns[(size_t) i].min);
+            g.fillRect((float) x, top, 1.f, jmax(1.f, bottom - top));
+        }
+    };
+
+    auto numInput = pyramid.read(Crusher::ScopePyramid::input, samplesPerPixel, inputColumns.data(), width);
+    auto numOutput = pyramid.read(Crusher::ScopePyramid::output, samplesPerPixel, outputColumns.data(), width);
+
+    g.setColour(Colours::grey);
+    drawColumns(inputColumns, numInput);
+
+    g.setColour(Colour(255u, 126u, 13u).withAlpha(0.8f));
+    drawColumns(outputColumns, numOutput);
+}
+
+void ScopeDisplay::resized()
+{
+    auto width = (size_t) juce::jmax(0, getWidth());
+
+    inputColumns.resize(width);
+    outputColumns.resize(width);
+}
+
+void ScopeDisplay::mouseWheelMove(const juce::MouseEvent&, const juce::MouseWheelDetails& wheel)
+{
+    auto zoom = wheel.deltaY > 0.f ? 0.5 : 2.0;
+    auto maxSamplesPerPixel = Crusher::ScopePyramid::getMaxSamplesPerPixel(juce::jmax(1, getWidth()));
+
+    samplesPerPixel = juce::jlimit(Crusher::ScopePyramid::baseBinSize, maxSamplesPerPixel, juce::roundToInt(samplesPerPixel * zoom));
+    repaint();
+}
+
+void TransferCurveDisplay::setBitSteps(float newBitSteps)
+{
+    if (newBitSteps == bitSteps)
+        return;
+
+    bitSteps = newBitSteps;
+    cachedCurve = {};
+    repaint();
+}
+
+void TransferCurveDisplay::setCurve(Crusher::CurveType newType, const juce::Array<float>& newUserLevels)
+{
+    if (newType == curveType && (newType != Crusher::CurveType::user || newUserLevels == userLevels))
+        return;
+
+    curveType = newType;
+    userLevels = newUserLevels;
+
+    if (curveType == Crusher::CurveType::user)
+        curve.buildFromLevels(userLevels);
+    else
+        curve.build(curveType);
+
+    cachedCurve = {};
+    repaint();
+}
+
+void TransferCurveDisplay::resized()
+{
+    cachedCurve = {};
+}
+
+void TransferCurveDisplay::renderCurve(float scale)
+{
+    using namespace juce;
+
+    auto bounds = getLocalBounds();
+
+    cachedScale = scale;
+    cachedCurve = Image(Image::RGB, roundToInt(bounds.getWidth() * scale), roundToInt(bounds.getHeight() * scale), true);
+
+    Graphics g(cachedCurve);
+    g.addTransform(AffineTransform::scale(scale));
+
+    auto area = bounds.toFloat();
+
+    g.fillAll(Colours::black);
+    g.setColour(Colours::dimgrey);
+    g.drawRect(area, 1.f);
+    g.drawLine(area.getX(), area.getCentreY(), area.getRight(), area.getCentreY());
+    g.drawLine(area.getCentreX(), area.getY(), area.getCentreX(), area.getBottom());
+
+    // Run the actual quantizer over a ramp, one point per pixel column
+    auto numPoints = cachedCurve.getWidth();
+    std::vector<float> points((size_t) numPoints);
+
+    for (int i = 0; i < numPoints; ++i)
+        points[(size_t) i] = jmap((float) i, 0.f, (float) (numPoints - 1), -1.f, 1.f);
+
+    if (curveType == Crusher::CurveType::linear)
+    {
+        Crusher::getScalarKernel<float>().quantizeMix(points.data(), numPoints, Crusher::Coefficients::make(bitSteps, 1.f));
+    }
+    else
+    {
+        const float fullyWet = 1.f;
+        curve.process(points.data(), numPoints, nullptr, &bitSteps, &fullyWet, 0);
+    }
+
+    Path staircase;
+
+    for (int i = 0; i < numPoints; ++i)
+    {
+        auto x = jmap((float) i, 0.f, (float) (numPoints - 1), area.getX(), area.getRight());
+        auto y = jmap(jlimit(-1.f, 1.f, points[(size_t) i]), 1.f, -1.f, area.getY(), area.getBottom());
+
+        if (i == 0)
+            staircase.startNewSubPath(x, y);
+        else
+            staircase.lineTo(x, y);
+    }
+
+    g.setColour(Colour(255u, 126u, 13u));
+    g.strokePath(staircase, PathStrokeType(1.5f));
+}
+
+void TransferCurveDisplay::paint(juce::Graphics& g)
+{
+    if (getLocalBounds().isEmpty())
+        return;
+
+    // Rendered at the display's pixel density, so it stays sharp on high-DPI screens
+    auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    if (cachedCurve.isNull() || scale != cachedScale)
+        renderCurve(scale);
+
+    g.drawImage(cachedCurve, getLocalBounds().toFloat());
+}
+
+#if CRUSHER_BLOCK_TIMING
+void BlockTimingOverlay::update()
+{
+    snapshot = timing.getSnapshot();
+    repaint();
+}
+
+void BlockTimingOverlay::paint(juce::Graphics& g)
+{
+    using namespace juce;
+
+    g.fillAll(Colours::black.withAlpha(0.8f));
+    g.setColour(Colours::dimgrey);
+    g.drawRect(getLocalBounds(), 1);
+
+    auto bounds = getLocalBounds().reduced(4);
+    auto textArea = bounds.removeFromTop(28);
+
+    auto meanSeconds = snapshot.numBlocks > 0 ? snapshot.totalSeconds / (double) snapshot.numBlocks : 0.0;
+
+    g.setColour(Colours::lightgrey);
+    g.setFont(11.f);
+    g.drawText("blocks " + String((int64) snapshot.numBlocks) + "  overruns " + String((int64) snapshot.numOverruns),
+               textArea.removeFromTop(14), Justification::centredLeft);
+    g.drawText("mean " + String(meanSeconds * 1.0e6, 1) + " us  max " + String(snapshot.maxSeconds * 1.0e6, 1)
+                   + " us  worst " + String(snapshot.worstLoad * 100.0, 0) + " %",
+               textArea, Justification::centredLeft);
+
+    // One bar per bin, heights on a log scale so single outliers still show
+    juce::uint64 mostBlocks = 1;
+
+    for (auto count : snapshot.bins)
+        mostBlocks = jmax(mostBlocks, count);
+
+    auto barWidth = (float) bounds.getWidth() / Crusher::BlockTiming::numBins;
+    auto logMost = std::log1p((double) mostBlocks);
+
+    g.setColour(Colour(255u, 126u, 13u));
+
+    for (int bin = 0; bin < Crusher::BlockTiming::numBins; ++bin)
+    {
+        auto count = snapshot.bins[(size_t) bin];
+
+        if (count == 0)
+            continue;
+
+        auto height = (float) (bounds.getHeight() * std::log1p((double) count) / logMost);
+        g.fillRect(bounds.getX() + bin * barWidth, (float) bounds.getBottom() - height, jmax(1.f, barWidth - 1.f), height);
+    }
+
+    // Blocks right of this line missed their deadline
+    if (snapshot.budgetSeconds > 0.0)
+    {
+        auto budgetX = bounds.getX() + Crusher::BlockTiming::getBin(snapshot.budgetSeconds) * barWidth;
+
+        g.setColour(Colour(207u, 34u, 0u));
+        g.fillRect(budgetX, (float) bounds.getY(), 1.f, (float) bounds.getHeight());
+    }
+}
+
+void BlockTimingOverlay::mouseDown(const juce::MouseEvent&)
+{
+    juce::PopupMenu menu;
+    juce::Component::SafePointer<BlockTimingOverlay> safePtr(this);
+
+    menu.addItem("Reset", [safePtr]
+        {
+            if (auto* overlay = safePtr.getComponent())
+                overlay->timing.reset();
+        });
+
+    menu.addItem("Save Report...", [safePtr]
+        {
+            auto* overlay = safePtr.getComponent();
+
+            if (overlay == nullptr)
+                return;
+
+            overlay->chooser = std::make_unique<juce::FileChooser>("Save Block Timing Report",
+                juce::File::getSpecialLocation(juce::File::userDesktopDirectory).getChildFile("BitCrusherTiming.txt"), "*.txt");
+
+            overlay->chooser->launchAsync(juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::warnAboutOverwriting,
+                [safePtr](const juce::FileChooser& chooser)
+                {
+                    auto file = chooser.getResult();
+
+                    if (auto* owner = safePtr.getComponent(); owner != nullptr && file != juce::File())
+                        owner->timing.writeReport(file);
+                });
+        });
+
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(this));
+}
+#endif
+
 //==============================================================================
 BitCrusherAudioProcessorEditor::BitCrusherAudioProcessorEditor (BitCrusherAudioProcessor& p)
     : AudioProcessorEditor (&p), audioProcessor (p),
@@ -359,7 +738,8 @@ BitCrusherAudioProcessorEditor::BitCrusherAudioProcessorEditor (BitCrusherAudioP
 
     bitStepsSliderAttachment(audioProcessor.apvts, "Bit Steps", bitStepsSlider),
     dryWetMixSliderAttachment(audioProcessor.apvts, "Dry Wet Mix", dryWetMixSlider),
-    bypassButtonAttachment(audioProcessor.apvts, "Bypass", bypassButton)
+    bypassButtonAttachment(audioProcessor.apvts, "Bypass", bypassButton),
+    scope(audioProcessor.getScopePyramid())
 {
     // Make sure that before the constructor has finished, you've set the
     // editor's size to whatever you need it to be.
@@ -371,6 +751,10 @@ BitCrusherAudioProcessorEditor::BitCrusherAudioProcessorEditor (BitCrusherAudioP
         addAndMakeVisible(comp);
     }
 
+   #if CRUSHER_BLOCK_TIMING
+    addAndMakeVisible(timingOverlay); // last, so it sits on top
+   #endif
+
     bitStepsSlider.labels.add({ 0.f, "1" });
     bitStepsSlider.labels.add({ 1.22f, "Quantization Steps" });
     bitStepsSlider.labels.add({ 1.f, "32" });
@@ -384,7 +768,7 @@ BitCrusherAudioProcessorEditor::BitCrusherAudioProcessorEditor (BitCrusherAudioP
 
     bypassButton.names.add({ "BYPASS" });
     
-    bypassButton.setLookAndFeel(&lnf);
+    bypassButton.setLookAndFeel(&resources->lookAndFeel);
 
     bypassButton.setToggleState(false, false);
 
@@ -401,11 +785,34 @@ BitCrusherAudioProcessorEditor::BitCrusherAudioProcessorEditor (BitCrusherAudioP
             }
         };
 
-    setSize (400, 300);
+    presetsButton.setColour(juce::TextButton::buttonColourId, juce::Colours::black);
+    presetsButton.setColour(juce::TextButton::textColourOffId, juce::Colour(255u, 126u, 13u));
+    presetsButton.onClick = [safePtr]()
+        {
+            if (auto* comp = safePtr.getComponent())
+                comp->showPresetMenu();
+        };
+
+    bitStepsValue = audioProcessor.apvts.getRawParameterValue("Bit Steps");
+    stepModeValue = audioProcessor.apvts.getRawParameterValue("Step Mode");
+    curveValue = audioProcessor.apvts.getRawParameterValue("Quantization Curve");
+
+    transferCurve.setBitSteps(Crusher::getQuantizerSteps(chainSettings.bitSteps, chainSettings.stepMode));
+    transferCurve.setCurve(chainSettings.curve, audioProcessor.getUserCurve());
+    shownCurveType = chainSettings.curve;
+    shownUserCurveRevision = audioProcessor.getUserCurveRevision();
+
+    setSize (460, 400);
+
+    audioProcessor.setMeteringEnabled(true);
+    startTimerHz(60);
 }
 
 BitCrusherAudioProcessorEditor::~BitCrusherAudioProcessorEditor()
 {
+    stopTimer();
+    audioProcessor.setMeteringEnabled(false);
+
     bypassButton.setLookAndFeel(nullptr);
 }
 
@@ -415,6 +822,16 @@ void BitCrusherAudioProcessorEditor::paint (juce::Graphics& g)
     using namespace juce;
     // (Our component is opaque, so we must completely fill the background with a solid colour)
     g.fillAll(Colours::black);
+
+    g.setColour(Colour(255u, 126u, 13u));
+    g.setFont(resources->labelFont);
+
+    auto labels = meterLabelsArea;
+    auto labelWidth = labels.getWidth() / 3;
+
+    g.drawFittedText("IN", labels.removeFromLeft(labelWidth), Justification::centred, 1);
+    g.drawFittedText("OUT", labels.removeFromLeft(labelWidth), Justification::centred, 1);
+    g.drawFittedText("ERR", labels, Justification::centred, 1);
 }
 
 void BitCrusherAudioProcessorEditor::resized()
@@ -423,24 +840,191 @@ void BitCrusherAudioProcessorEditor::resized()
     // subcomponents in your editor..
     auto bounds = getLocalBounds();
 
-    bounds.removeFromTop(20);
+    presetsButton.setBounds(bounds.removeFromTop(20).removeFromRight(80).reduced(2));
     bounds.removeFromBottom(20);
 
+    auto metersArea = bounds.removeFromRight(60).reduced(4, 0);
+
+    auto scopeArea = bounds.removeFromBottom(100).reduced(10, 0);
+    transferCurve.setBounds(scopeArea.removeFromLeft(scopeArea.getHeight()));
+    scopeArea.removeFromLeft(10);
+    scope.setBounds(scopeArea);
+    bounds.removeFromBottom(10);
+
+    meterLabelsArea = metersArea.removeFromBottom(16);
+
+    auto meterWidth = metersArea.getWidth() / 3;
+
+    inputMeter.setBounds(metersArea.removeFromLeft(meterWidth).reduced(2, 0));
+    outputMeter.setBounds(metersArea.removeFromLeft(meterWidth).reduced(2, 0));
+    errorMeter.setBounds(metersArea.reduced(2, 0));
+
     auto slidersArea = bounds.removeFromTop(bounds.getHeight() * 0.5f);
 
-    bitStepsSlider.setBounds(slidersArea.removeFromLeft(slidersArea.getWidth() * 0.5f));
-    dryWetMixSlider.setBounds(slidersArea);
+    bitStepsSlider.setLabelledBounds(slidersArea.removeFromLeft(slidersArea.getWidth() * 0.5f));
+    dryWetMixSlider.setLabelledBounds(slidersArea);
 
     bypassButton.setBounds(bounds);
+
+   #if CRUSHER_BLOCK_TIMING
+    timingOverlay.setBounds(getLocalBounds().removeFromTop(100).removeFromLeft(240).reduced(4));
+   #endif
+}
+
+void BitCrusherAudioProcessorEditor::timerCallback()
+{
+    // Peaks jump up and fall back at about 20 dB/s, RMS follows with a short release
+    constexpr float peakRelease = 0.9624f; // -20 dB/s at 60 fps
+    constexpr float rmsRelease = 0.8f;
+
+    Crusher::MeterFrame newest;
+    auto gotFrame = false;
+
+    Crusher::MeterFrame frame;
+
+    while (audioProcessor.popMeterFrame(frame))
+    {
+        newest.inputPeak = juce::jmax(newest.inputPeak, frame.inputPeak);
+        newest.outputPeak = juce::jmax(newest.outputPeak, frame.outputPeak);
+        newest.inputRms = juce::jmax(newest.inputRms, frame.inputRms);
+        newest.outputRms = juce::jmax(newest.outputRms, frame.outputRms);
+        newest.errorRms = juce::jmax(newest.errorRms, frame.errorRms);
+        gotFrame = true;
+    }
+
+    auto stepMode = static_cast<Crusher::StepMode>(juce::roundToInt(stepModeValue->load()));
+    auto curveType = static_cast<Crusher::CurveType>(juce::roundToInt(curveValue->load()));
+    transferCurve.setBitSteps(Crusher::getQuantizerSteps(bitStepsValue->load(), stepMode));
+
+    if (curveType != Crusher::CurveType::user)
+    {
+        transferCurve.setCurve(curveType, {});
+    }
+    else if (auto revision = audioProcessor.getUserCurveRevision(); revision != shownUserCurveRevision || curveType != shownCurveType)
+    {
+        transferCurve.setCurve(curveType, audioProcessor.getUserCurve());
+        shownUserCurveRevision = revision;
+    }
+
+    shownCurveType = curveType;
+
+   #if CRUSHER_BLOCK_TIMING
+    if (--timingUpdateCountdown <= 0)
+    {
+        timingOverlay.update();
+        timingUpdateCountdown = 6; // 10 Hz
+    }
+   #endif
+
+    // Big host buffers can leave a few ticks with nothing new; hold rather than dip.
+    // Any longer and the host has stopped or suspended processing, so the meters
+    // fall back towards silence as usual.
+    constexpr int maxHeldTicks = 12; // 200 ms, longer than an 8192-sample buffer at 48 kHz
+
+    if (gotFrame)
+    {
+        ticksWithoutFrame = 0;
+        scope.repaint();
+    }
+    else if (ticksWithoutFrame < maxHeldTicks)
+    {
+        ++ticksWithoutFrame;
+        return;
+    }
+
+    auto follow = [](float& level, float target, float release)
+    {
+        level = target >= level ? target : juce::jmax(target, level * release);
+    };
+
+    follow(meterLevels.inputPeak, newest.inputPeak, peakRelease);
+    follow(meterLevels.outputPeak, newest.outputPeak, peakRelease);
+    follow(meterLevels.inputRms, newest.inputRms, rmsRelease);
+    follow(meterLevels.outputRms, newest.outputRms, rmsRelease);
+    follow(meterLevels.errorRms, newest.errorRms, rmsRelease);
+
+    inputMeter.setLevels(meterLevels.inputRms, meterLevels.inputPeak);
+    outputMeter.setLevels(meterLevels.outputRms, meterLevels.outputPeak);
+    errorMeter.setLevels(meterLevels.errorRms, meterLevels.errorRms);
+}
+
+void BitCrusherAudioProcessorEditor::showPresetMenu()
+{
+    using MorphSlot = BitCrusherAudioProcessor::MorphSlot;
+
+    juce::PopupMenu recallMenu, storeMenu, morphAMenu, morphBMenu;
+    auto safePtr = juce::Component::SafePointer<BitCrusherAudioProcessorEditor>(this);
+
+    auto addSlotItem = [safePtr](juce::PopupMenu& slotMenu, MorphSlot slot, const juce::String& name, int presetIndex)
+    {
+        slotMenu.addItem(name, [safePtr, slot, presetIndex]
+            {
+                if (auto* comp = safePtr.getComponent())
+                {
+                    if (presetIndex < 0)
+                        comp->audioProcessor.captureMorphSlot(slot);
+                    else
+                        comp->audioProcessor.loadMorphSlot(slot, presetIndex);
+                }
+            });
+    };
+
+    addSlotItem(morphAMenu, MorphSlot::a, "Current Settings", -1);
+    addSlotItem(morphBMenu, MorphSlot::b, "Current Settings", -1);
+    morphAMenu.addSeparator();
+    morphBMenu.addSeparator();
+
+    for (int index = 0; index < BitCrusherAudioProcessor::numPresets; ++index)
+    {
+        auto name = audioProcessor.getPreset(index).name;
+
+        recallMenu.addItem(name, true, index == audioProcessor.getCurrentProgram(), [safePtr, index]
+            {
+                if (auto* comp = safePtr.getComponent())
+                    comp->audioProcessor.setCurrentProgram(index);
+            });
+
+        // Only the user slots can be overwritten
+        if (index >= BitCrusherAudioProcessor::numFactoryPresets)
+        {
+            storeMenu.addItem(name, [safePtr, index, name]
+                {
+                    if (auto* comp = safePtr.getComponent())
+                        comp->audioProcessor.storePreset(index, name);
+                });
+        }
+
+        addSlotItem(morphAMenu, MorphSlot::a, name, index);
+        addSlotItem(morphBMenu, MorphSlot::b, name, index);
+    }
+
+    juce::PopupMenu menu;
+    menu.addSubMenu("Recall", recallMenu);
+    menu.addSubMenu("Store Into", storeMenu);
+    menu.addSeparator();
+    menu.addSubMenu("Morph A", morphAMenu);
+    menu.addSubMenu("Morph B", morphBMenu);
+
+    menu.showMenuAsync(juce::PopupMenu::Options().withTargetComponent(&presetsButton));
 }
 
 std::vector<juce::Component*> BitCrusherAudioProcessorEditor::getComps()
 {
     return
     {
+        &bitStepsSlider.getLabelsComponent(), // behind the sliders
+        &dryWetMixSlider.getLabelsComponent(),
         &bitStepsSlider,
         &dryWetMixSlider,
 
-        &bypassButton
+        &bypassButton,
+        &presetsButton,
+
+        &inputMeter,
+        &outputMeter,
+        &errorMeter,
+
+        &scope,
+        &transferCurve
     };
 }
\ No newline at end of file
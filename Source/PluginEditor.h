@@ -14,6 +14,8 @@
 /**
 */
 
+struct RotarySliderWithLabels;
+
 struct LookAndFeel : juce::LookAndFeel_V4
 {
     void drawRotarySlider(juce::Graphics&,
@@ -23,10 +25,59 @@ struct LookAndFeel : juce::LookAndFeel_V4
         float rotaryEndAngle,
         juce::Slider&) override;
 
+    /** The parts of drawRotarySlider that don't depend on the value, and those that do,
+        so the first can be cached. */
+    void drawRotarySliderBody(juce::Graphics& g, juce::Rectangle<float> bounds, bool enabled);
+    void drawRotarySliderPointer(juce::Graphics& g, juce::Rectangle<float> bounds, float angle,
+                                 RotarySliderWithLabels& slider);
+
     void drawToggleButton(juce::Graphics& g,
         juce::ToggleButton& toggleButton,
         bool shouldDrawButtonAsHighlighted,
         bool shouldDrawButtonAsDown) override;
+
+    void drawPowerGlyph(juce::Graphics& g, juce::Rectangle<int> bounds, bool on);
+};
+
+//==============================================================================
+/** The look-and-feel, fonts and prerendered artwork every open editor uses.
+
+    Held through juce::SharedResourcePointer, so there is one per process no
+    matter how many plugin instances are loaded: it is created when the first
+    editor opens and destroyed when the last one closes. Message thread only.
+*/
+struct SharedEditorResources
+{
+    LookAndFeel lookAndFeel;
+
+    juce::Font captionFont{ 15.f }, labelFont{ 12.f }, valueFont{ 14.f };
+
+    /** A knob body of the given diameter, with a 2 px margin for the ring on every
+        side, rendered at the given pixel scale on first request. */
+    juce::Image getKnobBody(int diameter, float scale, bool enabled);
+
+    /** The power glyph for a button of the given size, without its caption. */
+    juce::Image getPowerGlyph(int width, int height, float scale, bool on);
+
+private:
+    struct AssetKey
+    {
+        int kind, width, height, variant;
+        float scale;
+
+        bool operator<(const AssetKey& other) const noexcept
+        {
+            return std::tie(kind, width, height, variant, scale)
+                 < std::tie(other.kind, other.width, other.height, other.variant, other.scale);
+        }
+    };
+
+    template <typename RenderFn>
+    juce::Image getAsset(const AssetKey& key, RenderFn&& render);
+
+    // Editors come in only a few sizes; this just stops resizing from hoarding images
+    static constexpr size_t maxAssets = 32;
+    std::map<AssetKey, juce::Image> assets;
 };
 
 struct RotarySliderWithLabels : juce::Slider
@@ -35,9 +86,11 @@ struct RotarySliderWithLabels : juce::Slider
         juce::Slider(juce::Slider::SliderStyle::RotaryHorizontalVerticalDrag,
             juce::Slider::TextEntryBoxPosition::NoTextBox),
         param(&rap),
-        suffix(unitSuffix)
+        suffix(unitSuffix),
+        labelsComponent(*this)
     {
-        setLookAndFeel(&lnf);
+        setLookAndFeel(&resources->lookAndFeel);
+        setRepaintsOnMouseActivity(false);
     }
 
     ~RotarySliderWithLabels()
@@ -63,16 +116,46 @@ struct RotarySliderWithLabels : juce::Slider
     void paint(juce::Graphics& g) override;
     juce::Rectangle<int> getSliderBounds() const;
     int getTextHeight() const { return 14; }
+
+    /** Places the knob and the labels around it in area, in the parent's coordinates.
+        The slider itself only covers the knob, so the repaint juce::Slider does on
+        every value change stays off the labels; add getLabelsComponent() to the same
+        parent, behind the slider.
+    */
+    void setLabelledBounds(juce::Rectangle<int> area);
+    juce::Component& getLabelsComponent() { return labelsComponent; }
     juce::String getDisplayString() const;
     void mouseDown(const juce::MouseEvent& event) override;
 
+    static constexpr float startAng = juce::degreesToRadians(180.f + 55.f);
+    static constexpr float endAng = juce::degreesToRadians(180.f - 55.f) + juce::MathConstants<float>::twoPi;
+
 private:
-    LookAndFeel lnf;
+    juce::SharedResourcePointer<SharedEditorResources> resources;
+
+    struct Labels : juce::Component
+    {
+        explicit Labels(RotarySliderWithLabels& owner) : slider(owner) { setInterceptsMouseClicks(false, false); }
+
+        void paint(juce::Graphics& g) override { slider.paintLabels(g); }
+
+        RotarySliderWithLabels& slider;
+    };
+
+    // The labels around the knob at the last seen pixel scale; the knob body itself
+    // comes from the shared resources. Set the labels up before the slider is shown.
+    juce::Image labelLayer;
+    float labelScale = 1.f;
+
+    void paintLabels(juce::Graphics& g);
+    void renderLabels(float scale);
 
     juce::RangedAudioParameter* param;
     juce::RangedAudioParameter* name;
     juce::String suffix;
 
+    Labels labelsComponent;
+
     void showTextEditor();
     void updateSliderValue(juce::TextEditor* editor, juce::Slider* slider);
 };
@@ -86,15 +169,108 @@ struct PowerButton : juce::ToggleButton
 
     juce::Array<ButtonName> names;
 
+    PowerButton() { setRepaintsOnMouseActivity(false); }
+
     void paint(juce::Graphics& g) override;
     juce::Rectangle<int> getButtonBounds() const;
     int getTextHeight() const { return 14; }
+
+private:
+    juce::SharedResourcePointer<SharedEditorResources> resources;
 };
 
+struct LevelMeter : juce::Component
+{
+    LevelMeter() { setOpaque(true); }
+
+    /** Sets the bar (RMS) and the hold line (peak), as linear gains. Only repaints
+        when either has moved far enough to show.
+    */
+    void setLevels(float rms, float peak);
+
+    void paint(juce::Graphics& g) override;
+
+    static constexpr float minDecibels = -60.f;
+
+private:
+    float rmsDecibels = minDecibels, peakDecibels = minDecibels;
+};
+
+/** Input (grey) and output (orange) envelopes over a zoomable time span, read
+    from the processor's min/max pyramid one column per pixel. The mouse wheel
+    zooms.
+*/
+struct ScopeDisplay : juce::Component
+{
+    explicit ScopeDisplay(const Crusher::ScopePyramid& source) : pyramid(source) { setOpaque(true); }
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+    void mouseWheelMove(const juce::MouseEvent& event, const juce::MouseWheelDetails& wheel) override;
+
+private:
+    const Crusher::ScopePyramid& pyramid;
+    int samplesPerPixel = 64;
+
+    // Sized in resized(), so painting never allocates
+    std::vector<Crusher::ScopePyramid::Range> inputColumns, outputColumns;
+};
+
+/** The quantizer's staircase for the current Bit Steps. It only changes with Bit
+    Steps, the step mode, the quantization curve or the component's size, so it
+    is rendered once into an image and just blitted on every other repaint.
+*/
+struct TransferCurveDisplay : juce::Component
+{
+    TransferCurveDisplay() { setOpaque(true); }
+
+    /** Takes the step count the quantizer actually uses, see Crusher::getQuantizerSteps. */
+    void setBitSteps(float newBitSteps);
+
+    /** The user levels are only looked at for CurveType::user. */
+    void setCurve(Crusher::CurveType newType, const juce::Array<float>& newUserLevels);
+
+    void paint(juce::Graphics& g) override;
+    void resized() override;
+
+private:
+    void renderCurve(float scale);
+
+    float bitSteps = 16.f;
+    Crusher::CurveType curveType = Crusher::CurveType::linear;
+    juce::Array<float> userLevels;
+    Crusher::CompandingCurve curve;
+    juce::Image cachedCurve; // null when it needs rendering again
+    float cachedScale = 1.f;
+};
+
+#if CRUSHER_BLOCK_TIMING
+/** Debug overlay, only in builds with CRUSHER_BLOCK_TIMING: the histogram of
+    processBlock times on a log axis, with the real-time budget marked, and the
+    overrun count. Clicking it offers to reset the counts or save a report.
+*/
+struct BlockTimingOverlay : juce::Component
+{
+    explicit BlockTimingOverlay(Crusher::BlockTiming& source) : timing(source) {}
+
+    /** Takes a fresh snapshot and repaints. */
+    void update();
+
+    void paint(juce::Graphics& g) override;
+    void mouseDown(const juce::MouseEvent& event) override;
+
+private:
+    Crusher::BlockTiming& timing;
+    Crusher::BlockTiming::Snapshot snapshot;
+    std::unique_ptr<juce::FileChooser> chooser;
+};
+#endif
+
 //==============================================================================
 /**
 */
-class BitCrusherAudioProcessorEditor  : public juce::AudioProcessorEditor
+class BitCrusherAudioProcessorEditor  : public juce::AudioProcessorEditor,
+                                        private juce::Timer
 {
 public:
     BitCrusherAudioProcessorEditor (BitCrusherAudioProcessor&);
@@ -122,7 +298,35 @@ private:
 
     ButtonAttachment bypassButtonAttachment;
 
-    LookAndFeel lnf;
+    // Recalls and stores the processor's presets and fills its morph snapshots
+    juce::TextButton presetsButton{ "PRESETS" };
+
+    void showPresetMenu();
+
+    juce::SharedResourcePointer<SharedEditorResources> resources;
+
+    LevelMeter inputMeter, outputMeter, errorMeter;
+    ScopeDisplay scope;
+    TransferCurveDisplay transferCurve;
+    Crusher::MeterFrame meterLevels; // after ballistics
+    int ticksWithoutFrame = 0;
+
+    // What the transfer curve follows, read straight from the parameters so the
+    // timer never looks them up by name. The user levels are only fetched, which
+    // allocates, when their revision or the curve type changes.
+    std::atomic<float>* bitStepsValue = nullptr;
+    std::atomic<float>* stepModeValue = nullptr;
+    std::atomic<float>* curveValue = nullptr;
+    Crusher::CurveType shownCurveType = Crusher::CurveType::linear;
+    int shownUserCurveRevision = 0;
+    juce::Rectangle<int> meterLabelsArea;
+
+   #if CRUSHER_BLOCK_TIMING
+    BlockTimingOverlay timingOverlay{ audioProcessor.getBlockTiming() };
+    int timingUpdateCountdown = 0;
+   #endif
+
+    void timerCallback() override;
 
     std::vector<juce::Component*> getComps();
 
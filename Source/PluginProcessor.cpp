@@ -9,6 +9,45 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 
+static std::array<Preset, BitCrusherAudioProcessor::numPresets> createFactoryPresets()
+{
+    std::array<Preset, BitCrusherAudioProcessor::numPresets> presets;
+
+    presets[0].name = "Init";
+
+    presets[1].name = "8-Bit Console";
+    presets[1].settings.stepMode = Crusher::StepMode::bitDepth;
+    presets[1].settings.bitSteps = 8.f;
+    presets[1].settings.dryWetMix = 1.f;
+    presets[1].settings.downsample = 2.f;
+
+    presets[2].name = "Vintage Sampler";
+    presets[2].settings.stepMode = Crusher::StepMode::bitDepth;
+    presets[2].settings.bitSteps = 12.f;
+    presets[2].settings.dryWetMix = 1.f;
+    presets[2].settings.downsample = 1.6f;
+    presets[2].settings.downsampleSmoothing = true;
+    presets[2].settings.dither = Crusher::DitherMode::triangular;
+
+    presets[3].name = "Telephone";
+    presets[3].settings.stepMode = Crusher::StepMode::bitDepth;
+    presets[3].settings.bitSteps = 8.f;
+    presets[3].settings.dryWetMix = 1.f;
+    presets[3].settings.curve = Crusher::CurveType::muLaw;
+    presets[3].settings.downsample = 6.f;
+
+    presets[4].name = "Destroyed";
+    presets[4].settings.bitSteps = 3.f;
+    presets[4].settings.dryWetMix = 1.f;
+    presets[4].settings.downsample = 16.f;
+    presets[4].settings.jitter = 0.5f;
+
+    for (size_t i = BitCrusherAudioProcessor::numFactoryPresets; i < presets.size(); ++i)
+        presets[i].name = "User " + juce::String(i - BitCrusherAudioProcessor::numFactoryPresets + 1);
+
+    return presets;
+}
+
 //==============================================================================
 BitCrusherAudioProcessor::BitCrusherAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -22,10 +61,65 @@ BitCrusherAudioProcessor::BitCrusherAudioProcessor()
                        )
 #endif
 {
+    bitStepsParam = apvts.getRawParameterValue("Bit Steps");
+    dryWetMixParam = apvts.getRawParameterValue("Dry Wet Mix");
+    stepModeParam = apvts.getRawParameterValue("Step Mode");
+    autoGainParam = apvts.getRawParameterValue("Auto Gain");
+    bypassParam = apvts.getRawParameterValue("Bypass");
+    oversamplingParam = apvts.getRawParameterValue("Oversampling");
+    oversamplingFilterParam = apvts.getRawParameterValue("Oversampling Filter");
+    antialiasingParam = apvts.getRawParameterValue("Antialiasing");
+    downsampleParam = apvts.getRawParameterValue("Downsample");
+    jitterParam = apvts.getRawParameterValue("Jitter");
+    downsampleSmoothingParam = apvts.getRawParameterValue("Downsample Smoothing");
+    ditherParam = apvts.getRawParameterValue("Dither");
+    noiseShapingParam = apvts.getRawParameterValue("Noise Shaping");
+    curveParam = apvts.getRawParameterValue("Quantization Curve");
+    morphParam = apvts.getRawParameterValue("Morph");
+    morphEnabledParam = apvts.getRawParameterValue("Morph Presets");
+
+    for (size_t lfo = 0; lfo < lfos.size(); ++lfo)
+    {
+        auto prefix = "LFO " + juce::String(lfo + 1);
+        lfoShapeParams[lfo] = apvts.getRawParameterValue(prefix + " Shape");
+        lfoRateParams[lfo] = apvts.getRawParameterValue(prefix + " Rate");
+    }
+
+    envelopeAttackParam = apvts.getRawParameterValue("Envelope Attack");
+    envelopeReleaseParam = apvts.getRawParameterValue("Envelope Release");
+    stepsModSourceParam = apvts.getRawParameterValue("Steps Mod Source");
+    stepsModDepthParam = apvts.getRawParameterValue("Steps Mod Depth");
+    mixModSourceParam = apvts.getRawParameterValue("Mix Mod Source");
+    mixModDepthParam = apvts.getRawParameterValue("Mix Mod Depth");
+    bandsParam = apvts.getRawParameterValue("Bands");
+    channelModeParam = apvts.getRawParameterValue("Channel Mode");
+    secondBitStepsParam = apvts.getRawParameterValue("Bit Steps 2");
+    secondDryWetMixParam = apvts.getRawParameterValue("Dry Wet Mix 2");
+
+    for (size_t crossover = 0; crossover < crossoverParams.size(); ++crossover)
+        crossoverParams[crossover] = apvts.getRawParameterValue("Crossover " + juce::String(crossover + 1));
+
+    for (size_t band = 0; band < (size_t) maxBands; ++band)
+    {
+        bandBitStepsParams[band] = apvts.getRawParameterValue("Band " + juce::String(band + 1) + " Bit Steps");
+        bandDryWetMixParams[band] = apvts.getRawParameterValue("Band " + juce::String(band + 1) + " Dry Wet Mix");
+    }
+
+    presets = createFactoryPresets();
+    morphPair = { presets[0].settings, presets[1].settings };
+    publishMorphPair();
+
+    builtInCurves[0].build(Crusher::CurveType::muLaw);
+    builtInCurves[1].build(Crusher::CurveType::aLaw);
+    builtInCurves[2].build(Crusher::CurveType::logarithmic);
+
+    floatKernel = &Crusher::getKernel<float>();
+    doubleKernel = &Crusher::getKernel<double>();
 }
 
 BitCrusherAudioProcessor::~BitCrusherAudioProcessor()
 {
+    stopTimer();
 }
 
 //==============================================================================
@@ -63,43 +157,114 @@ bool BitCrusherAudioProcessor::isMidiEffect() const
 
 double BitCrusherAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLengthSeconds.load();
 }
 
 int BitCrusherAudioProcessor::getNumPrograms()
 {
-    return 1;   // NB: some hosts don't cope very well if you tell them there are 0 programs,
-                // so this should be at least 1, even if you're not really implementing programs.
+    return numPresets;
 }
 
 int BitCrusherAudioProcessor::getCurrentProgram()
 {
-    return 0;
+    return currentPreset;
 }
 
 void BitCrusherAudioProcessor::setCurrentProgram (int index)
 {
+    if (! juce::isPositiveAndBelow(index, numPresets))
+        return;
+
+    currentPreset = index;
+    applyChainSettings(apvts, presets[(size_t) index].settings);
 }
 
 const juce::String BitCrusherAudioProcessor::getProgramName (int index)
 {
-    return {};
+    return juce::isPositiveAndBelow(index, numPresets) ? presets[(size_t) index].name : juce::String();
 }
 
 void BitCrusherAudioProcessor::changeProgramName (int index, const juce::String& newName)
 {
+    if (juce::isPositiveAndBelow(index, numPresets))
+        presets[(size_t) index].name = newName;
 }
 
 //==============================================================================
 void BitCrusherAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
- 
+    juce::ignoreUnused(samplesPerBlock);
+
+    auto chainSettings = readChainSettings();
+
+    currentSampleRate = sampleRate;
+
+    // Every factor and filter is built up front, so switching between them
+    // on the audio thread never allocates
+    auto numChannels = (size_t) juce::jmax(1, getTotalNumInputChannels(), getTotalNumOutputChannels());
+
+    if (isUsingDoublePrecision())
+    {
+        doubleOversamplers.prepare(numChannels);
+        floatOversamplers.release();
+        doubleDryBuffer.setSize((int) numChannels, maxChunkSize);
+        floatDryBuffer.setSize(0, 0);
+        doubleDryDelay.prepare((int) numChannels, doubleOversamplers.getMaxLatency());
+        floatDryDelay.prepare(0, 0);
+        doubleCrossover.prepare((int) numChannels, maxChunkSize);
+        floatCrossover.prepare(0, 0);
+    }
+    else
+    {
+        floatOversamplers.prepare(numChannels);
+        doubleOversamplers.release();
+        floatDryBuffer.setSize((int) numChannels, maxChunkSize);
+        doubleDryBuffer.setSize(0, 0);
+        floatDryDelay.prepare((int) numChannels, floatOversamplers.getMaxLatency());
+        doubleDryDelay.prepare(0, 0);
+        floatCrossover.prepare((int) numChannels, maxChunkSize);
+        doubleCrossover.prepare(0, 0);
+    }
+
+    setActiveOversampling(chainSettings.oversampling, chainSettings.oversamplingFilter);
+    setLatencySamples(activeLatencySamples);
+    startTimerHz(10);
+
+    adaaStates.assign(numChannels, {});
+    sampleRateReducer.prepare((int) numChannels);
+    blockMeter.prepare((int) numChannels, maxChunkSize);
+    activeAntialiasing = chainSettings.antialiasing;
+
+    ditherNoise.assign(numChannels, {});
+    noiseShapers.assign(numChannels, {});
+
+    for (size_t channel = 0; channel < numChannels; ++channel)
+        ditherNoise[channel].seed((juce::uint32) channel);
+
+    activeNoiseShaping = chainSettings.noiseShaping;
+
+    for (auto& lfo : lfos)
+        lfo.reset();
+
+    envelopeFollower.reset();
+
+    jumpToTargets(chainSettings);
+
+    coefficients = Crusher::Coefficients::make(chainSettings.bitSteps, chainSettings.dryWetMix, chainSettings.stepMode);
+
+    // The fade runs at the host rate, outside the oversampler
+    fullyBypassed = isEffectivelyBypassed(chainSettings);
+    bypassFade.reset(sampleRate, bypassFadeSeconds);
+    bypassFade.setCurrentAndTargetValue(fullyBypassed ? 1.f : 0.f);
+    silentOutputSamples = 0;
+    idle = false;
 }
 
 void BitCrusherAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    stopTimer();
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -109,12 +274,11 @@ bool BitCrusherAudioProcessor::isBusesLayoutSupported (const BusesLayout& layout
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Every channel is crushed the same way, so any layout works, from mono up to
+    // surround, immersive and ambisonic buses, as long as it isn't empty or too wide.
+    auto numChannels = layouts.getMainOutputChannelSet().size();
+
+    if (numChannels < 1 || numChannels > maxNumChannels)
         return false;
 
     // This checks if the input layout matches the output layout
@@ -129,91 +293,1508 @@ bool BitCrusherAudioProcessor::isBusesLayoutSupported (const BusesLayout& layout
 #endif
 
 void BitCrusherAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+   #if CRUSHER_BLOCK_TIMING
+    Crusher::BlockTiming::Scope timingScope(blockTiming, buffer.getNumSamples(), currentSampleRate);
+   #endif
+
+    processSamples(buffer, midiMessages);
+}
+
+void BitCrusherAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+   #if CRUSHER_BLOCK_TIMING
+    Crusher::BlockTiming::Scope timingScope(blockTiming, buffer.getNumSamples(), currentSampleRate);
+   #endif
+
+    processSamples(buffer, midiMessages);
+}
+
+bool BitCrusherAudioProcessor::supportsDoubleProcessing() const
+{
+    return true;
+}
+
+juce::AudioProcessorParameter* BitCrusherAudioProcessor::getBypassParameter() const
+{
+    return apvts.getParameter("Bypass");
+}
+
+template <typename SampleType>
+void BitCrusherAudioProcessor::processSamples(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages)
 {
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
     auto numSamples = buffer.getNumSamples();
 
-    auto chainSettings = getChainSettings(apvts);
+    auto numProcessedChannels = juce::jmin(totalNumOutputChannels, totalNumInputChannels);
+
+    auto chainSettings = readChainSettings();
+
+    auto& dryDelay = [this]() -> DryDelay<SampleType>&
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doubleDryDelay;
+        else
+            return floatDryDelay;
+    }();
+
+    auto& dryBuffer = [this]() -> juce::AudioBuffer<SampleType>&
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doubleDryBuffer;
+        else
+            return floatDryBuffer;
+    }();
+
+    meteringBlock = meteringEnabled.load(std::memory_order_acquire);
+    auto meteredBlock = juce::dsp::AudioBlock<SampleType>(buffer).getSubsetChannelBlock(0, (size_t) numProcessedChannels);
 
-    auto bitSteps = chainSettings.bitSteps;
-    auto dryWetMix = chainSettings.dryWetMix;
-    auto bypass = chainSettings.bypass;
+    if (meteringBlock)
+    {
+        blockMeter.measureInput(meteredBlock);
+        scopePyramid.push(Crusher::ScopePyramid::input, meteredBlock);
+    }
 
-    if (bypass == false)
+    bypassFade.setTargetValue(isEffectivelyBypassed(chainSettings) ? 1.f : 0.f);
+
+    // Once the fade out has finished, a bypassed block costs nothing beyond the metering
+    // and holding the dry signal back by the latency the host still compensates for
+    if (bypassFade.getTargetValue() == 1.f && ! bypassFade.isSmoothing())
     {
-        for (int channel = 0; channel < totalNumOutputChannels; ++channel)
+        dryDelay.process(buffer, 0, buffer, 0, numProcessedChannels, numSamples, activeLatencySamples);
+        jumpToTargets(chainSettings);
+        fullyBypassed = true;
+
+        if (meteringBlock)
         {
-            if (channel > totalNumInputChannels) buffer.clear(channel, 0, numSamples);
-            else
+            blockMeter.measureOutput(meteredBlock);
+            meterFifo.push(blockMeter.finishFrame());
+            scopePyramid.push(Crusher::ScopePyramid::output, meteredBlock);
+        }
+
+        return;
+    }
+
+    if (chainSettings.oversampling != activeOversampling || chainSettings.oversamplingFilter != activeOversamplingFilter)
+        setActiveOversampling(chainSettings.oversampling, chainSettings.oversamplingFilter);
+
+    if (chainSettings.antialiasing != activeAntialiasing)
+    {
+        for (auto& state : adaaStates)
+            state.reset();
+
+        activeAntialiasing = chainSettings.antialiasing;
+    }
+
+    if (chainSettings.noiseShaping != activeNoiseShaping)
+    {
+        for (auto& shaper : noiseShapers)
+            shaper.reset();
+
+        activeNoiseShaping = chainSettings.noiseShaping;
+    }
+
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    // Outputs without a matching input hold garbage and must be silenced
+    for (int channel = totalNumInputChannels; channel < totalNumOutputChannels; ++channel)
+        buffer.clear(channel, 0, numSamples);
+
+    // Silence in, and everything still ringing from earlier has died away: the output
+    // would be silence too, so write exact zeros without running anything. Hosts and
+    // downstream plugins that look for digital silence then see it. The input has to
+    // be exact zeros, since the quantizer turns even the quietest signal into whole
+    // steps; the tail only has to be below the threshold. Anything still on
+    // its way through the oversampling filters or held by the sample-rate reducer
+    // would come out within the filters' tail plus one hold, so the output has to
+    // have been silent for at least that long first.
+    auto inputSilent = isSilent(buffer, numProcessedChannels, 0.f);
+    auto holdSamples = (int) std::ceil(chainSettings.downsample * (1.f + 0.5f * chainSettings.jitter));
+
+    if (inputSilent && silentOutputSamples >= activeTailSamples + holdSamples && ! bypassFade.isSmoothing())
+    {
+        // Whatever is left in the filters is below the silence threshold; drop it so
+        // it can't resurface when the input comes back
+        if (! idle)
+        {
+            resetProcessingState();
+            dryDelay.reset();
+            idle = true;
+        }
+
+        buffer.clear();
+        jumpToTargets(chainSettings);
+        idleBlocks.fetch_add(1, std::memory_order_relaxed);
+
+        if (meteringBlock)
+        {
+            blockMeter.measureOutput(meteredBlock);
+            meterFifo.push(blockMeter.finishFrame());
+            scopePyramid.push(Crusher::ScopePyramid::output, meteredBlock);
+        }
+
+        return;
+    }
+
+    // Work through the buffer in cache-sized sub-blocks, also cutting at every MIDI
+    // event, and pick up the latest parameter values at each boundary. Whatever
+    // buffer size the host uses, the kernels only ever see at most maxChunkSize
+    // samples, oversampled or not.
+    auto subBlockSize = maxChunkSize >> activeOversampling;
+    auto nextEvent = midiMessages.cbegin();
+
+    for (int start = 0; start < numSamples;)
+    {
+        auto end = juce::jmin(numSamples, start + subBlockSize);
+
+        for (; nextEvent != midiMessages.cend(); ++nextEvent)
+        {
+            auto eventPos = (*nextEvent).samplePosition;
+
+            if (eventPos > start)
             {
-                auto* channelData = buffer.getWritePointer(channel, 0);
-                for (int smp = 0; smp < numSamples; ++smp)
-                {
-                    DBG(compensateArray[int(bitSteps) - 1]);
+                end = juce::jmin(end, eventPos);
+                break;
+            }
+        }
 
-                    if (channelData[smp] > 0)
-                    {
-                        channelData[smp] = std::ceil(channelData[smp] * bitSteps) / bitSteps  * dryWetMix + (channelData[smp]) * (1 - dryWetMix);
-                    }
-                    if (channelData[smp] < 0)
-                    {
-                        channelData[smp] = std::floor(channelData[smp] * bitSteps) / bitSteps * dryWetMix + (channelData[smp]) * (1 - dryWetMix);
-                    }
+        if (start > 0)
+        {
+            chainSettings = readChainSettings();
+            bypassFade.setTargetValue(isEffectivelyBypassed(chainSettings) ? 1.f : 0.f);
+        }
 
-                }
+        // The dry input for this stretch, delayed to line up with the processed signal
+        dryDelay.process(buffer, start, dryBuffer, 0, numProcessedChannels, end - start, activeLatencySamples);
+
+        if (bypassFade.getTargetValue() == 1.f && ! bypassFade.isSmoothing())
+        {
+            // Faded out part way through the block; the rest stays dry
+            for (int channel = 0; channel < numProcessedChannels; ++channel)
+                buffer.copyFrom(channel, start, dryBuffer, channel, 0, end - start);
+
+            jumpToTargets(chainSettings);
+            fullyBypassed = true;
+        }
+        else
+        {
+            // Everything held over from before the bypass is stale; fade in from scratch
+            if (fullyBypassed)
+            {
+                resetProcessingState();
+                fullyBypassed = false;
             }
+
+            if (bypassFade.isSmoothing())
+                crossfadeBypass(buffer, start, end - start, chainSettings, numProcessedChannels);
+            else
+                processSubBlock(buffer, start, end - start, chainSettings, numProcessedChannels);
         }
+
+        start = end;
     }
-}
 
-//==============================================================================
-bool BitCrusherAudioProcessor::hasEditor() const
-{
-    return true; // (change this to false if you choose to not supply an editor)
-}
+    // Only worth checking once the input has gone quiet
+    idle = false;
 
-juce::AudioProcessorEditor* BitCrusherAudioProcessor::createEditor()
-{
-    return new BitCrusherAudioProcessorEditor (*this);
-    //return new juce::GenericAudioProcessorEditor(*this);
+    if (inputSilent && isSilent(buffer, numProcessedChannels, silenceThreshold))
+        silentOutputSamples = juce::jmin(silentOutputSamples + numSamples, std::numeric_limits<int>::max() / 2);
+    else
+        silentOutputSamples = 0;
+    processedBlocks.fetch_add(1, std::memory_order_relaxed);
+
+    if (meteringBlock)
+    {
+        blockMeter.measureOutput(meteredBlock);
+        meterFifo.push(blockMeter.finishFrame());
+        scopePyramid.push(Crusher::ScopePyramid::output, meteredBlock);
+    }
+
+    if (numSamples > 0)
+    {
+        auto elapsedSeconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+        auto& cost = processingCost[(size_t) activeOversampling];
+        auto nsPerSample = float(elapsedSeconds * 1.0e9 / numSamples);
+
+        cost.store(cost.load() + 0.05f * (nsPerSample - cost.load()));
+    }
 }
 
-//==============================================================================
-void BitCrusherAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+template <typename SampleType>
+void BitCrusherAudioProcessor::processSubBlock(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples,
+                                               const ChainSettings& chainSettings, int numChannels)
 {
-    juce::MemoryOutputStream mos(destData, true);
-    apvts.state.writeToStream(mos);
+    auto* oversampler = [this]
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doubleOversamplers.active;
+        else
+            return floatOversamplers.active;
+    }();
+
+    auto block = juce::dsp::AudioBlock<SampleType>(buffer).getSubsetChannelBlock(0, (size_t) numChannels)
+                                                          .getSubBlock((size_t) startSample, (size_t) numSamples);
+
+    if (oversampler != nullptr)
+    {
+        auto oversampledBlock = oversampler->processSamplesUp(block);
+        quantizeBlock(oversampledBlock, chainSettings);
+        oversampler->processSamplesDown(block);
+    }
+    else
+    {
+        quantizeBlock(block, chainSettings);
+    }
 }
 
-void BitCrusherAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
+template <typename SampleType>
+void BitCrusherAudioProcessor::crossfadeBypass(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples,
+                                               const ChainSettings& chainSettings, int numChannels)
 {
-    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
-    if (tree.isValid())
+    auto& dryBuffer = [this]() -> juce::AudioBuffer<SampleType>&
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doubleDryBuffer;
+        else
+            return floatDryBuffer;
+    }();
+
+    // processSamples has already put the delayed dry input for this stretch in the dry buffer
+    jassert(numSamples <= dryBuffer.getNumSamples());
+    numChannels = juce::jmin(numChannels, dryBuffer.getNumChannels());
+
+    processSubBlock(buffer, startSample, numSamples, chainSettings, numChannels);
+
+    // Equal power, so the level holds up in the middle when the two are uncorrelated
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        auto angle = bypassFade.getNextValue() * juce::MathConstants<float>::halfPi;
+        fadeWetRamp[(size_t) smp] = std::cos(angle);
+        fadeDryRamp[(size_t) smp] = std::sin(angle);
+    }
+
+    for (int channel = 0; channel < numChannels; ++channel)
     {
-        apvts.replaceState(tree);
+        auto* data = buffer.getWritePointer(channel, startSample);
+        auto* dry = dryBuffer.getReadPointer(channel);
+
+        for (int smp = 0; smp < numSamples; ++smp)
+            data[smp] = data[smp] * (SampleType) fadeWetRamp[(size_t) smp] + dry[smp] * (SampleType) fadeDryRamp[(size_t) smp];
     }
 }
 
-ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+template <typename SampleType>
+void BitCrusherAudioProcessor::quantizeBlock(juce::dsp::AudioBlock<SampleType>& block, const ChainSettings& chainSettings)
 {
-    ChainSettings settings;
+    auto numSamples = (int) block.getNumSamples();
+    auto numChannels = block.getNumChannels();
 
-    settings.bitSteps = apvts.getRawParameterValue("Bit Steps")->load();
-    settings.dryWetMix = apvts.getRawParameterValue("Dry Wet Mix")->load();
-    settings.bypass = apvts.getRawParameterValue("Bypass")->load() > 0.5f;
+    jassert(numSamples <= maxChunkSize);
 
-    return settings;
+    // Channel 1 takes the second set of settings when the channels aren't linked
+    auto channelMode = numChannels > 1 ? chainSettings.channelMode : ChannelMode::linked;
+    auto split = channelMode != ChannelMode::linked;
+
+    auto quantizerSteps = Crusher::getQuantizerSteps(chainSettings.bitSteps, chainSettings.stepMode);
+    auto secondQuantizerSteps = Crusher::getQuantizerSteps(chainSettings.secondBitSteps, chainSettings.stepMode);
+
+    bitStepsSmoothed.setTargetValue(quantizerSteps);
+    dryWetMixSmoothed.setTargetValue(chainSettings.dryWetMix);
+    secondBitStepsSmoothed.setTargetValue(secondQuantizerSteps);
+    secondDryWetMixSmoothed.setTargetValue(chainSettings.secondDryWetMix);
+
+    if (! split)
+    {
+        secondBitStepsSmoothed.skip(numSamples);
+        secondDryWetMixSmoothed.skip(numSamples);
+    }
+
+    auto smoothing = bitStepsSmoothed.isSmoothing() || dryWetMixSmoothed.isSmoothing()
+                  || (split && (secondBitStepsSmoothed.isSmoothing() || secondDryWetMixSmoothed.isSmoothing()));
+    auto modulated = isModulated(chainSettings);
+    auto ramping = smoothing || modulated;
+    std::array<bool, 3> modulationRendered{};
+
+    if (ramping)
+    {
+        auto renderRamps = [numSamples](auto& stepsSmoothed, auto& mixSmoothed, float* stepsRamp, float* mixRamp)
+        {
+            if (stepsSmoothed.isSmoothing() || mixSmoothed.isSmoothing())
+            {
+                for (int smp = 0; smp < numSamples; ++smp)
+                {
+                    stepsRamp[smp] = stepsSmoothed.getNextValue();
+                    mixRamp[smp] = mixSmoothed.getNextValue();
+                }
+            }
+            else
+            {
+                juce::FloatVectorOperations::fill(stepsRamp, stepsSmoothed.getTargetValue(), numSamples);
+                juce::FloatVectorOperations::fill(mixRamp, mixSmoothed.getTargetValue(), numSamples);
+            }
+        };
+
+        renderRamps(bitStepsSmoothed, dryWetMixSmoothed, bitStepsRamp.data(), wetRamp.data());
+
+        if (split)
+            renderRamps(secondBitStepsSmoothed, secondDryWetMixSmoothed, secondBitStepsRamp.data(), secondWetRamp.data());
+
+        // Modulation goes on top of the smoothed values, so the same vector kernels
+        // that handle parameter ramps take it per sample
+        if (modulated)
+        {
+            modulateRamps(block, chainSettings, bitStepsRamp.data(), wetRamp.data(), modulationRendered);
+
+            if (split)
+                modulateRamps(block, chainSettings, secondBitStepsRamp.data(), secondWetRamp.data(), modulationRendered);
+        }
+    }
+    else
+    {
+        // Nothing is moving: one set of coefficients, straight from the step tables, covers the whole sub-block
+        if (! coefficients.matches(quantizerSteps, chainSettings.dryWetMix))
+            coefficients = Crusher::Coefficients::make(chainSettings.bitSteps, chainSettings.dryWetMix, chainSettings.stepMode);
+
+        if (split && ! secondCoefficients.matches(secondQuantizerSteps, chainSettings.secondDryWetMix))
+            secondCoefficients = Crusher::Coefficients::make(chainSettings.secondBitSteps, chainSettings.secondDryWetMix, chainSettings.stepMode);
+    }
+
+    if (meteringBlock)
+        blockMeter.captureDry(block);
+
+    // Sample-rate reduction runs over the same cache-resident sub-block right before the
+    // quantizer, with the hold time scaled so it stays the same in real time when oversampling
+    if (chainSettings.downsample > 1.f || chainSettings.jitter > 0.f)
+        sampleRateReducer.process(block, chainSettings.downsample * float(1 << activeOversampling),
+                                  chainSettings.jitter, chainSettings.downsampleSmoothing);
+
+    // A stride of 0 holds the cached coefficients for the whole sub-block
+    struct ChannelParameters
+    {
+        const float* bitSteps;
+        const float* wet;
+        const Crusher::Coefficients* coefficients;
+    };
+
+    const ChannelParameters firstParameters{ ramping ? bitStepsRamp.data() : &coefficients.bitSteps,
+                                             ramping ? wetRamp.data() : &coefficients.wet, &coefficients };
+    const ChannelParameters secondParameters = split ? ChannelParameters{ ramping ? secondBitStepsRamp.data() : &secondCoefficients.bitSteps,
+                                                                          ramping ? secondWetRamp.data() : &secondCoefficients.wet,
+                                                                          &secondCoefficients }
+                                                     : firstParameters;
+    auto parametersFor = [&](size_t channel) -> const ChannelParameters& { return channel == 1 ? secondParameters : firstParameters; };
+    auto stride = ramping ? 1 : 0;
+
+    // The plain quantizer and the curves turn a channel of exact zeros into exact
+    // zeros, so they skip it. Dither, noise shaping, ADAA and the band filters can
+    // all produce output from zeros, from their noise or their history, so nothing
+    // is skipped for them.
+    auto memoryless = chainSettings.numBands <= 1 && chainSettings.antialiasing == Crusher::AntialiasingMode::off
+                   && chainSettings.noiseShaping == 0 && chainSettings.dither == Crusher::DitherMode::off;
+
+    std::array<bool, maxNumChannels> silent{};
+
+    if (memoryless)
+        for (size_t channel = 0; channel < juce::jmin(numChannels, silent.size()); ++channel)
+            silent[channel] = isSilent(block.getChannelPointer(channel), numSamples, 0.f);
+
+    // Mid and side are only silent if both sides are
+    if (channelMode == ChannelMode::midSide)
+        silent[0] = silent[1] = silent[0] && silent[1];
+
+    auto numSilent = (size_t) std::count(silent.begin(), silent.end(), true);
+
+    skippedChannelBlocks.fetch_add(numSilent, std::memory_order_relaxed);
+    processedChannelBlocks.fetch_add(numChannels - numSilent, std::memory_order_relaxed);
+
+    const Crusher::Kernel<SampleType>* kernel = nullptr;
+
+    if constexpr (std::is_same_v<SampleType, double>)
+        kernel = doubleKernel;
+    else
+        kernel = floatKernel;
+
+    // The plain quantizer has a kernel that encodes, quantizes and decodes mid/side
+    // in one pass. For every other path the pair is encoded before and decoded after.
+    auto plain = memoryless && chainSettings.curve == Crusher::CurveType::linear;
+    auto encoded = channelMode == ChannelMode::midSide && ! plain && ! silent[0];
+
+    if (encoded)
+        encodeMidSide(block.getChannelPointer(0), block.getChannelPointer(1), numSamples);
+
+    // ADAA already smooths the staircase out, so dither and noise shaping only
+    // apply to the plain quantizer. The non-linear curves take dither, on their
+    // compressed scale, but no noise shaping: the error feedback assumes even steps.
+    if (chainSettings.numBands > 1)
+    {
+        quantizeBands(block, chainSettings, silent.data(), modulationRendered);
+    }
+    else if (chainSettings.antialiasing != Crusher::AntialiasingMode::off)
+    {
+        jassert(numChannels <= adaaStates.size());
+
+        for (size_t channel = 0; channel < juce::jmin(numChannels, adaaStates.size()); ++channel)
+        {
+            if (silent[channel])
+                continue;
+
+            const auto& parameters = parametersFor(channel);
+            adaaStates[channel].process(chainSettings.antialiasing, block.getChannelPointer(channel), numSamples,
+                                        parameters.bitSteps, parameters.wet, stride);
+        }
+    }
+    else if (chainSettings.curve != Crusher::CurveType::linear)
+    {
+        jassert(numChannels <= ditherNoise.size());
+
+        const auto& curve = getCurve(chainSettings.curve);
+        auto* noise = chainSettings.dither != Crusher::DitherMode::off ? ditherBuffer.data() : nullptr;
+
+        for (size_t channel = 0; channel < juce::jmin(numChannels, ditherNoise.size()); ++channel)
+        {
+            if (silent[channel])
+                continue;
+
+            if (noise != nullptr)
+                ditherNoise[channel].fill(chainSettings.dither, noise, numSamples);
+
+            const auto& parameters = parametersFor(channel);
+            curve.process(block.getChannelPointer(channel), numSamples, noise, parameters.bitSteps, parameters.wet, stride);
+        }
+    }
+    else if (chainSettings.noiseShaping > 0)
+    {
+        jassert(numChannels <= noiseShapers.size());
+
+        auto* noise = chainSettings.dither != Crusher::DitherMode::off ? ditherBuffer.data() : nullptr;
+
+        for (size_t channel = 0; channel < juce::jmin(numChannels, noiseShapers.size()); ++channel)
+        {
+            if (silent[channel])
+                continue;
+
+            if (noise != nullptr)
+                ditherNoise[channel].fill(chainSettings.dither, noise, numSamples);
+
+            const auto& parameters = parametersFor(channel);
+            noiseShapers[channel].process(chainSettings.noiseShaping, block.getChannelPointer(channel), numSamples,
+                                          noise, parameters.bitSteps, parameters.wet, stride);
+        }
+    }
+    else if (chainSettings.dither != Crusher::DitherMode::off)
+    {
+        jassert(numChannels <= ditherNoise.size());
+
+        // Each channel's kernel draws the noise from that channel's own generator as it goes
+        for (size_t channel = 0; channel < juce::jmin(numChannels, ditherNoise.size()); ++channel)
+        {
+            if (silent[channel])
+                continue;
+
+            const auto& parameters = parametersFor(channel);
+
+            if (ramping)
+                kernel->quantizeMixRampDither(block.getChannelPointer(channel), numSamples, parameters.bitSteps, parameters.wet,
+                                              ditherNoise[channel], chainSettings.dither);
+            else
+                kernel->quantizeMixDither(block.getChannelPointer(channel), numSamples, *parameters.coefficients,
+                                          ditherNoise[channel], chainSettings.dither);
+        }
+    }
+    else
+    {
+        size_t firstChannel = 0;
+
+        if (channelMode == ChannelMode::midSide)
+        {
+            if (! silent[0] && ramping)
+                kernel->quantizeMixMidSideRamp(block.getChannelPointer(0), block.getChannelPointer(1), numSamples,
+                                               bitStepsRamp.data(), wetRamp.data(), secondBitStepsRamp.data(), secondWetRamp.data());
+            else if (! silent[0])
+                kernel->quantizeMixMidSide(block.getChannelPointer(0), block.getChannelPointer(1), numSamples,
+                                           coefficients, secondCoefficients);
+
+            firstChannel = 2;
+        }
+
+        if (ramping)
+        {
+            // The channels sharing the first set of ramps go through the kernel together
+            std::array<SampleType*, maxNumChannels> channels;
+            size_t numRampChannels = 0;
+
+            for (size_t channel = firstChannel; channel < juce::jmin(numChannels, channels.size()); ++channel)
+                if (! silent[channel] && ! (split && channel == 1))
+                    channels[numRampChannels++] = block.getChannelPointer(channel);
+
+            kernel->quantizeMixRampChannels(channels.data(), (int) numRampChannels, numSamples, bitStepsRamp.data(), wetRamp.data());
+
+            if (channelMode == ChannelMode::leftRight && ! silent[1])
+                kernel->quantizeMixRamp(block.getChannelPointer(1), numSamples, secondBitStepsRamp.data(), secondWetRamp.data());
+        }
+        else
+        {
+            for (size_t channel = firstChannel; channel < numChannels; ++channel)
+                if (! silent[channel])
+                    kernel->quantizeMix(block.getChannelPointer(channel), numSamples, *parametersFor(channel).coefficients);
+        }
+    }
+
+    if (encoded)
+        decodeMidSide(block.getChannelPointer(0), block.getChannelPointer(1), numSamples);
+
+    compensateBlock(block, chainSettings);
+
+    if (meteringBlock)
+        blockMeter.measureError(block);
 }
 
-juce::AudioProcessorValueTreeState::ParameterLayout BitCrusherAudioProcessor::createParameterLayout()
+template <typename SampleType>
+void BitCrusherAudioProcessor::quantizeBands(juce::dsp::AudioBlock<SampleType>& block, const ChainSettings& chainSettings,
+                                             const bool* silent, std::array<bool, 3>& modulationRendered)
 {
-    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+    auto numSamples = (int) block.getNumSamples();
+    auto numChannels = juce::jmin(block.getNumChannels(), ditherNoise.size());
 
-    layout.add(std::make_unique<juce::AudioParameterFloat>("Bit Steps", "Bit Steps", juce::NormalisableRange<float>(1.0f, 32.0f, 1.f, 1.f), 16.f));
-    layout.add(std::make_unique<juce::AudioParameterFloat>("Dry Wet Mix", "Dry Wet Mix", juce::NormalisableRange<float>(0.00f, 1.00f, 0.01f, 1.f), 0.50f));
-    layout.add(std::make_unique<juce::AudioParameterBool>("Bypass", "Bypass", false));
+    auto& crossover = [this]() -> Crusher::LinkwitzRileyCrossover<SampleType>&
+    {
+        if constexpr (std::is_same_v<SampleType, double>)
+            return doubleCrossover;
+        else
+            return floatCrossover;
+    }();
+
+    const Crusher::Kernel<SampleType>* kernel = nullptr;
+
+    if constexpr (std::is_same_v<SampleType, double>)
+        kernel = doubleKernel;
+    else
+        kernel = floatKernel;
+
+    crossover.process(block, chainSettings.numBands, chainSettings.crossoverFrequencies);
+
+    // Every band is crushed on its own, with the same quantizer the single band path
+    // uses minus ADAA and noise shaping, whose state is per channel, and then summed
+    // back into the block. The ramps are reused as scratch, one band at a time.
+    const auto modulated = isModulated(chainSettings);
+    const auto* curve = chainSettings.curve != Crusher::CurveType::linear ? &getCurve(chainSettings.curve) : nullptr;
+
+    for (int band = 0; band < chainSettings.numBands; ++band)
+    {
+        auto& stepsSmoothed = bandStepsSmoothed[(size_t) band];
+        auto& mixSmoothed = bandMixSmoothed[(size_t) band];
+        auto& bandCoeffs = bandCoefficients[(size_t) band];
+        auto bandSteps = chainSettings.bandBitSteps[(size_t) band];
+        auto bandMix = chainSettings.bandDryWetMix[(size_t) band];
+        auto quantizerSteps = Crusher::getQuantizerSteps(bandSteps, chainSettings.stepMode);
+
+        stepsSmoothed.setTargetValue(quantizerSteps);
+        mixSmoothed.setTargetValue(bandMix);
+
+        auto smoothing = stepsSmoothed.isSmoothing() || mixSmoothed.isSmoothing();
+        auto ramping = smoothing || modulated;
+
+        if (smoothing)
+        {
+            for (int smp = 0; smp < numSamples; ++smp)
+            {
+                bitStepsRamp[smp] = stepsSmoothed.getNextValue();
+                wetRamp[smp] = mixSmoothed.getNextValue();
+            }
+        }
+        else if (modulated)
+        {
+            juce::FloatVectorOperations::fill(bitStepsRamp.data(), quantizerSteps, numSamples);
+            juce::FloatVectorOperations::fill(wetRamp.data(), bandMix, numSamples);
+        }
+        else if (! bandCoeffs.matches(quantizerSteps, bandMix))
+        {
+            bandCoeffs = Crusher::Coefficients::make(bandSteps, bandMix, chainSettings.stepMode);
+        }
+
+        if (modulated)
+            modulateRamps(block, chainSettings, bitStepsRamp.data(), wetRamp.data(), modulationRendered);
+
+        auto* bitSteps = ramping ? bitStepsRamp.data() : &bandCoeffs.bitSteps;
+        auto* wet = ramping ? wetRamp.data() : &bandCoeffs.wet;
+        auto stride = ramping ? 1 : 0;
+        auto dithered = chainSettings.dither != Crusher::DitherMode::off;
+        auto* noise = dithered ? ditherBuffer.data() : nullptr;
+
+        for (size_t channel = 0; channel < numChannels; ++channel)
+        {
+            if (silent[channel])
+                continue;
+
+            auto* data = crossover.getBand(band, (int) channel);
+
+            if (curve != nullptr)
+            {
+                if (dithered)
+                    ditherNoise[channel].fill(chainSettings.dither, noise, numSamples);
+
+                curve->process(data, numSamples, noise, bitSteps, wet, stride);
+            }
+            else if (dithered && ramping)
+                kernel->quantizeMixRampDither(data, numSamples, bitStepsRamp.data(), wetRamp.data(), ditherNoise[channel], chainSettings.dither);
+            else if (dithered)
+                kernel->quantizeMixDither(data, numSamples, bandCoeffs, ditherNoise[channel], chainSettings.dither);
+            else if (ramping)
+                kernel->quantizeMixRamp(data, numSamples, bitStepsRamp.data(), wetRamp.data());
+            else
+                kernel->quantizeMix(data, numSamples, bandCoeffs);
+
+            if (band == 0)
+                juce::FloatVectorOperations::copy(block.getChannelPointer(channel), data, numSamples);
+            else
+                juce::FloatVectorOperations::add(block.getChannelPointer(channel), data, numSamples);
+        }
+    }
+}
+
+template <typename SampleType>
+void BitCrusherAudioProcessor::modulateRamps(const juce::dsp::AudioBlock<SampleType>& block, const ChainSettings& chainSettings,
+                                             float* stepsRamp, float* wetRamp, std::array<bool, 3>& rendered)
+{
+    auto numSamples = (int) block.getNumSamples();
+
+    // Each source is rendered once per sub-block, however many destinations and bands use it
+    auto getSignal = [&](Crusher::ModSource source) -> const float*
+    {
+        auto index = (size_t) source - 1;
+        auto* signal = modulationBuffers[index].data();
+
+        if (! rendered[index])
+        {
+            if (source == Crusher::ModSource::envelope)
+                envelopeFollower.process(block, chainSettings.envelopeAttack, chainSettings.envelopeRelease, signal);
+            else
+                lfos[index].process(chainSettings.lfoShapes[index], chainSettings.lfoRates[index], signal, numSamples);
+
+            rendered[index] = true;
+        }
+
+        return signal;
+    };
+
+    if (chainSettings.stepsModSource != Crusher::ModSource::off && chainSettings.stepsModDepth != 0.f)
+    {
+        // In octaves of the step count, i.e. bits, so a depth sounds alike at any setting
+        Crusher::multiplyByExp2(stepsRamp, getSignal(chainSettings.stepsModSource),
+                                chainSettings.stepsModDepth * maxStepsModulationBits, numSamples);
+        juce::FloatVectorOperations::max(stepsRamp, stepsRamp, 1.f, numSamples);
+    }
+
+    if (chainSettings.mixModSource != Crusher::ModSource::off && chainSettings.mixModDepth != 0.f)
+    {
+        juce::FloatVectorOperations::addWithMultiply(wetRamp, getSignal(chainSettings.mixModSource),
+                                                     chainSettings.mixModDepth, numSamples);
+        juce::FloatVectorOperations::clip(wetRamp, wetRamp, 0.f, 1.f, numSamples);
+    }
+}
+
+bool BitCrusherAudioProcessor::isModulated(const ChainSettings& chainSettings) noexcept
+{
+    return (chainSettings.stepsModSource != Crusher::ModSource::off && chainSettings.stepsModDepth != 0.f)
+        || (chainSettings.mixModSource != Crusher::ModSource::off && chainSettings.mixModDepth != 0.f);
+}
+
+template <typename SampleType>
+void BitCrusherAudioProcessor::encodeMidSide(SampleType* left, SampleType* right, int numSamples) noexcept
+{
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        auto l = left[smp], r = right[smp];
+        left[smp] = (l + r) * (SampleType) 0.5;
+        right[smp] = (l - r) * (SampleType) 0.5;
+    }
+}
+
+template <typename SampleType>
+void BitCrusherAudioProcessor::decodeMidSide(SampleType* mid, SampleType* side, int numSamples) noexcept
+{
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        auto m = mid[smp], s = side[smp];
+        mid[smp] = m + s;
+        side[smp] = m - s;
+    }
+}
+
+template <typename SampleType>
+void BitCrusherAudioProcessor::compensateBlock(juce::dsp::AudioBlock<SampleType>& block, const ChainSettings& chainSettings)
+{
+    auto numSamples = (int) block.getNumSamples();
+
+    compensationSmoothed.setTargetValue(getCompensationTarget(chainSettings));
+
+    if (compensationSmoothed.isSmoothing())
+    {
+        for (int smp = 0; smp < numSamples; ++smp)
+            compensationRamp[smp] = compensationSmoothed.getNextValue();
+
+        for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+        {
+            auto* data = block.getChannelPointer(channel);
+
+            for (int smp = 0; smp < numSamples; ++smp)
+                data[smp] *= (SampleType) compensationRamp[smp];
+        }
+    }
+    else if (compensationSmoothed.getTargetValue() != 1.f)
+    {
+        block.multiplyBy((SampleType) compensationSmoothed.getTargetValue());
+    }
+}
+
+const Crusher::CompandingCurve& BitCrusherAudioProcessor::getCurve(Crusher::CurveType type) noexcept
+{
+    switch (type)
+    {
+        case Crusher::CurveType::muLaw:        return builtInCurves[0];
+        case Crusher::CurveType::aLaw:         return builtInCurves[1];
+        case Crusher::CurveType::logarithmic:  return builtInCurves[2];
+        case Crusher::CurveType::user:
+        case Crusher::CurveType::linear:
+        default:                               return userCurve.acquire();
+    }
+}
+
+float BitCrusherAudioProcessor::getCompensationTarget(const ChainSettings& chainSettings) noexcept
+{
+    // Multiband, and unlinked channels, have several Bit Steps, which this single gain can't follow
+    if (! chainSettings.autoGain || chainSettings.numBands > 1 || chainSettings.channelMode != ChannelMode::linked)
+        return 1.f;
+
+    // The table gain is for a fully wet signal; the dry part needs none
+    auto gain = Crusher::getCompensationGain(chainSettings.bitSteps, chainSettings.stepMode);
+    return 1.f + chainSettings.dryWetMix * (gain - 1.f);
+}
+
+bool BitCrusherAudioProcessor::isEffectivelyBypassed(const ChainSettings& chainSettings) noexcept
+{
+    // A fully dry mix sounds the same as bypass, unless sample-rate reduction is on:
+    // that runs before the mix, so the dry side still carries it. Multiband and
+    // unlinked channels have mixes of their own, all of which have to be dry.
+    // Mix modulation goes on top of every one of them, and can open a dry mix up
+    // whenever it swings positive: at any depth from the bipolar LFOs, and at a
+    // positive one from the envelope.
+    auto mixModulated = chainSettings.mixModSource != Crusher::ModSource::off
+                     && (chainSettings.mixModDepth > 0.f
+                         || (chainSettings.mixModDepth < 0.f && chainSettings.mixModSource != Crusher::ModSource::envelope));
+
+    if (mixModulated)
+        return chainSettings.bypass;
+
+    auto dry = chainSettings.dryWetMix <= 0.f;
+
+    if (chainSettings.numBands > 1)
+        dry = std::all_of(chainSettings.bandDryWetMix.begin(), chainSettings.bandDryWetMix.begin() + chainSettings.numBands,
+                          [](float mix) { return mix <= 0.f; });
+    else if (chainSettings.channelMode != ChannelMode::linked)
+        dry = dry && chainSettings.secondDryWetMix <= 0.f;
+
+    return chainSettings.bypass || (dry && chainSettings.downsample <= 1.f && chainSettings.jitter <= 0.f);
+}
+
+template <typename SampleType>
+bool BitCrusherAudioProcessor::isSilent(const SampleType* data, int numSamples, float threshold) noexcept
+{
+    auto range = juce::FloatVectorOperations::findMinAndMax(data, numSamples);
+    return juce::jmax(-range.getStart(), range.getEnd()) <= (SampleType) threshold;
+}
+
+template <typename SampleType>
+bool BitCrusherAudioProcessor::isSilent(const juce::AudioBuffer<SampleType>& buffer, int numChannels, float threshold) noexcept
+{
+    for (int channel = 0; channel < numChannels; ++channel)
+        if (! isSilent(buffer.getReadPointer(channel), buffer.getNumSamples(), threshold))
+            return false;
+
+    return true;
+}
+
+void BitCrusherAudioProcessor::jumpToTargets(const ChainSettings& chainSettings)
+{
+    // Jump straight to the current values so un-bypassing doesn't ramp from stale ones
+    bitStepsSmoothed.setCurrentAndTargetValue(Crusher::getQuantizerSteps(chainSettings.bitSteps, chainSettings.stepMode));
+    dryWetMixSmoothed.setCurrentAndTargetValue(chainSettings.dryWetMix);
+    secondBitStepsSmoothed.setCurrentAndTargetValue(Crusher::getQuantizerSteps(chainSettings.secondBitSteps, chainSettings.stepMode));
+    secondDryWetMixSmoothed.setCurrentAndTargetValue(chainSettings.secondDryWetMix);
+    compensationSmoothed.setCurrentAndTargetValue(getCompensationTarget(chainSettings));
+
+    for (size_t band = 0; band < (size_t) maxBands; ++band)
+    {
+        bandStepsSmoothed[band].setCurrentAndTargetValue(Crusher::getQuantizerSteps(chainSettings.bandBitSteps[band], chainSettings.stepMode));
+        bandMixSmoothed[band].setCurrentAndTargetValue(chainSettings.bandDryWetMix[band]);
+    }
+}
+
+void BitCrusherAudioProcessor::resetProcessingState()
+{
+    if (floatOversamplers.active != nullptr)
+        floatOversamplers.active->reset();
+
+    if (doubleOversamplers.active != nullptr)
+        doubleOversamplers.active->reset();
+
+    for (auto& state : adaaStates)
+        state.reset();
+
+    for (auto& shaper : noiseShapers)
+        shaper.reset();
+
+    sampleRateReducer.reset();
+    floatCrossover.reset();
+    doubleCrossover.reset();
+}
+
+void BitCrusherAudioProcessor::setActiveOversampling(int oversampling, OversamplingFilter filter)
+{
+    activeOversampling = juce::jlimit(0, maxOversampling, oversampling);
+    activeOversamplingFilter = filter;
+
+    auto doublePrecision = isUsingDoublePrecision();
+    auto latency = juce::roundToInt(doublePrecision ? doubleOversamplers.select(activeOversampling, filter)
+                                                    : floatOversamplers.select(activeOversampling, filter));
+
+    activeLatencySamples = latency;
+    activeTailSamples = doublePrecision ? doubleOversamplers.activeTailSamples : floatOversamplers.activeTailSamples;
+    latencyToReport.store(latency);
+    tailLengthSeconds = activeTailSamples / currentSampleRate;
+
+    // The smoothers tick once per processed sample, so they run at the oversampled rate
+    auto processingRate = currentSampleRate * (1 << activeOversampling);
+    bitStepsSmoothed.reset(processingRate, smoothingTimeSeconds);
+    dryWetMixSmoothed.reset(processingRate, smoothingTimeSeconds);
+    secondBitStepsSmoothed.reset(processingRate, smoothingTimeSeconds);
+    secondDryWetMixSmoothed.reset(processingRate, smoothingTimeSeconds);
+    compensationSmoothed.reset(processingRate, smoothingTimeSeconds);
+
+    for (auto& lfo : lfos)
+        lfo.setSampleRate(processingRate);
+
+    envelopeFollower.setSampleRate(processingRate);
+
+    for (size_t band = 0; band < (size_t) maxBands; ++band)
+    {
+        bandStepsSmoothed[band].reset(processingRate, smoothingTimeSeconds);
+        bandMixSmoothed[band].reset(processingRate, smoothingTimeSeconds);
+    }
+
+    // The crossover works at the oversampled rate too; only the active precision's is prepared
+    if (doublePrecision)
+        doubleCrossover.setSampleRate(processingRate);
+    else
+        floatCrossover.setSampleRate(processingRate);
+}
+
+void BitCrusherAudioProcessor::timerCallback()
+{
+    if (auto latency = latencyToReport.load(); latency != getLatencySamples())
+        setLatencySamples(latency);
+}
+
+template <typename SampleType>
+void BitCrusherAudioProcessor::OversamplerBank<SampleType>::prepare(size_t numChannels)
+{
+    for (int filter = 0; filter < 2; ++filter)
+    {
+        auto filterType = filter == (int) OversamplingFilter::polyphaseIIR ? Oversampler::filterHalfBandPolyphaseIIR
+                                                                            : Oversampler::filterHalfBandFIREquiripple;
+
+        for (int factor = 1; factor <= maxOversampling; ++factor)
+        {
+            auto& os = oversamplers[(size_t) (filter * maxOversampling + factor - 1)];
+            os = std::make_unique<Oversampler>(numChannels, (size_t) factor, filterType, true, true);
+            os->initProcessing((size_t) maxChunkSize);
+            tailSamples[(size_t) (filter * maxOversampling + factor - 1)] = measureTail(*os);
+        }
+    }
+
+    active = nullptr;
+    activeTailSamples = 0;
+}
+
+template <typename SampleType>
+void BitCrusherAudioProcessor::OversamplerBank<SampleType>::release()
+{
+    for (auto& os : oversamplers)
+        os.reset();
+
+    active = nullptr;
+    activeTailSamples = 0;
+}
+
+template <typename SampleType>
+double BitCrusherAudioProcessor::OversamplerBank<SampleType>::select(int oversampling, OversamplingFilter filter)
+{
+    auto index = (size_t) ((int) filter * maxOversampling + oversampling - 1);
+    active = oversampling > 0 ? oversamplers[index].get() : nullptr;
+    activeTailSamples = active != nullptr ? tailSamples[index] : 0;
+
+    if (active == nullptr)
+        return 0.0;
+
+    active->reset();
+    return (double) active->getLatencyInSamples();
+}
+
+template <typename SampleType>
+int BitCrusherAudioProcessor::OversamplerBank<SampleType>::measureTail(Oversampler& oversampler)
+{
+    // The polyphase IIR filters ring on well past their latency and never quite
+    // reach zero, so run an impulse through until a whole chunk stays quiet
+    constexpr int maxTailSamples = 1 << 16;
+
+    juce::AudioBuffer<SampleType> buffer(1, maxChunkSize);
+    buffer.clear();
+    buffer.setSample(0, 0, (SampleType) 1);
+
+    oversampler.reset();
+    auto tail = 0;
+
+    for (int start = 0; start < maxTailSamples; start += maxChunkSize)
+    {
+        auto block = juce::dsp::AudioBlock<SampleType>(buffer);
+        oversampler.processSamplesUp(block);
+        oversampler.processSamplesDown(block);
+
+        auto* data = buffer.getReadPointer(0);
+        auto audible = false;
+
+        for (int smp = 0; smp < maxChunkSize; ++smp)
+        {
+            if (std::abs(data[smp]) > (SampleType) silenceThreshold)
+            {
+                tail = start + smp + 1;
+                audible = true;
+            }
+        }
+
+        if (! audible && tail > 0)
+            break;
+
+        buffer.clear();
+    }
+
+    oversampler.reset();
+    return tail;
+}
+
+template <typename SampleType>
+int BitCrusherAudioProcessor::OversamplerBank<SampleType>::getMaxLatency() const
+{
+    auto latency = 0.0;
+
+    for (auto& os : oversamplers)
+        if (os != nullptr)
+            latency = juce::jmax(latency, (double) os->getLatencyInSamples());
+
+    return (int) std::ceil(latency);
+}
+
+//==============================================================================
+template <typename SampleType>
+void BitCrusherAudioProcessor::DryDelay<SampleType>::prepare(int numChannels, int maxDelaySamples)
+{
+    auto size = juce::nextPowerOfTwo(maxDelaySamples + 1);
+
+    lines.setSize(numChannels, size);
+    mask = size - 1;
+    reset();
+}
+
+template <typename SampleType>
+void BitCrusherAudioProcessor::DryDelay<SampleType>::reset()
+{
+    lines.clear();
+    writePosition = 0;
+}
+
+template <typename SampleType>
+void BitCrusherAudioProcessor::DryDelay<SampleType>::process(const juce::AudioBuffer<SampleType>& source, int sourceStart,
+                                                             juce::AudioBuffer<SampleType>& destination, int destinationStart,
+                                                             int numChannels, int numSamples, int delaySamples) noexcept
+{
+    jassert(delaySamples <= mask);
+    delaySamples = juce::jlimit(0, mask, delaySamples);
+    numChannels = juce::jmin(numChannels, lines.getNumChannels());
+
+    for (int channel = 0; channel < numChannels; ++channel)
+    {
+        auto* in = source.getReadPointer(channel, sourceStart);
+        auto* out = destination.getWritePointer(channel, destinationStart);
+        auto* line = lines.getWritePointer(channel);
+        auto position = writePosition;
+
+        // Each input sample is read before its output is written, so this works in place
+        for (int smp = 0; smp < numSamples; ++smp)
+        {
+            line[position] = in[smp];
+            out[smp] = line[(position - delaySamples) & mask];
+            position = (position + 1) & mask;
+        }
+    }
+
+    writePosition = (writePosition + numSamples) & mask;
+}
+
+float BitCrusherAudioProcessor::getProcessingCostNsPerSample(int oversampling) const noexcept
+{
+    return processingCost[(size_t) juce::jlimit(0, maxOversampling, oversampling)].load();
+}
+
+void BitCrusherAudioProcessor::setMeteringEnabled(bool shouldBeEnabled)
+{
+    // Most instances never open an editor, so the scope's history waits until one
+    // does; the release store publishes it before the audio thread first pushes
+    if (shouldBeEnabled)
+        scopePyramid.allocate();
+
+    meteringEnabled.store(shouldBeEnabled, std::memory_order_release);
+}
+
+bool BitCrusherAudioProcessor::popMeterFrame(Crusher::MeterFrame& frame) noexcept
+{
+    return meterFifo.pop(frame);
+}
+
+void BitCrusherAudioProcessor::setUserCurve(const juce::Array<float>& levels)
+{
+    apvts.state.setProperty("UserCurve", Crusher::CompandingCurve::levelsToString(levels), nullptr);
+    publishUserCurve(levels);
+}
+
+juce::Array<float> BitCrusherAudioProcessor::getUserCurve() const
+{
+    return Crusher::CompandingCurve::levelsFromString(apvts.state.getProperty("UserCurve").toString());
+}
+
+void BitCrusherAudioProcessor::publishUserCurve(const juce::Array<float>& levels)
+{
+    userCurve.getWriteSlot().buildFromLevels(levels);
+    userCurve.publish();
+    ++userCurveRevision;
+}
+
+void BitCrusherAudioProcessor::storePreset(int index, const juce::String& name)
+{
+    if (! juce::isPositiveAndBelow(index, numPresets))
+        return;
+
+    presets[(size_t) index] = { name, getChainSettings(apvts) };
+    updateHostDisplay(ChangeDetails().withProgramChanged(true));
+}
+
+const Preset& BitCrusherAudioProcessor::getPreset(int index) const
+{
+    return presets[(size_t) juce::jlimit(0, numPresets - 1, index)];
+}
+
+void BitCrusherAudioProcessor::loadMorphSlot(MorphSlot slot, int presetIndex)
+{
+    (slot == MorphSlot::a ? morphPair.a : morphPair.b) = getPreset(presetIndex).settings;
+    publishMorphPair();
+}
+
+void BitCrusherAudioProcessor::captureMorphSlot(MorphSlot slot)
+{
+    (slot == MorphSlot::a ? morphPair.a : morphPair.b) = getChainSettings(apvts);
+    publishMorphPair();
+}
+
+void BitCrusherAudioProcessor::publishMorphPair()
+{
+    morphSnapshots.getWriteSlot() = morphPair;
+    morphSnapshots.publish();
+}
+
+BitCrusherAudioProcessor::SilenceStats BitCrusherAudioProcessor::getSilenceStats() const noexcept
+{
+    SilenceStats stats;
+    stats.idleBlocks = idleBlocks.load(std::memory_order_relaxed);
+    stats.processedBlocks = processedBlocks.load(std::memory_order_relaxed);
+    stats.skippedChannelBlocks = skippedChannelBlocks.load(std::memory_order_relaxed);
+    stats.processedChannelBlocks = processedChannelBlocks.load(std::memory_order_relaxed);
+    return stats;
+}
+
+//==============================================================================
+bool BitCrusherAudioProcessor::hasEditor() const
+{
+    return true; // (change this to false if you choose to not supply an editor)
+}
+
+juce::AudioProcessorEditor* BitCrusherAudioProcessor::createEditor()
+{
+    return new BitCrusherAudioProcessorEditor (*this);
+    //return new juce::GenericAudioProcessorEditor(*this);
+}
+
+//==============================================================================
+void BitCrusherAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    auto state = Crusher::PluginState::capture(getParameters(), getUserCurve());
+
+    for (const auto& preset : presets)
+        state.presets.push_back({ preset.name, getParameterValues(preset.settings) });
+
+    state.currentPreset = currentPreset;
+    state.morphA = getParameterValues(morphPair.a);
+    state.morphB = getParameterValues(morphPair.b);
+    state.write(destData);
+}
+
+void BitCrusherAudioProcessor::setStateInformation(const void* data, int sizeInBytes)
+{
+    // Fast path: the parameters are set straight from the stored values
+    if (Crusher::PluginState::isBinary(data, (size_t) juce::jmax(0, sizeInBytes)))
+    {
+        Crusher::PluginState state;
+
+        if (Crusher::PluginState::read(data, (size_t) sizeInBytes, state))
+        {
+            state.applyTo(getParameters());
+            apvts.state.setProperty("UserCurve", Crusher::CompandingCurve::levelsToString(state.userCurve), nullptr);
+            publishUserCurve(state.userCurve);
+
+            // Version 1 blobs have no bank, so the current one stays
+            if (! state.presets.empty())
+            {
+                for (size_t i = 0; i < juce::jmin(state.presets.size(), presets.size()); ++i)
+                    presets[i] = { state.presets[i].name, getSettingsFromValues(state.presets[i].parameterValues) };
+
+                currentPreset = juce::jlimit(0, numPresets - 1, state.currentPreset);
+                morphPair = { getSettingsFromValues(state.morphA), getSettingsFromValues(state.morphB) };
+                publishMorphPair();
+                updateHostDisplay(ChangeDetails().withProgramChanged(true));
+            }
+        }
+
+        return;
+    }
+
+    // Sessions saved before the binary format hold the whole ValueTree
+    auto tree = juce::ValueTree::readFromData(data, sizeInBytes);
+    if (tree.isValid())
+        replaceState(tree);
+}
+
+void BitCrusherAudioProcessor::replaceState(const juce::ValueTree& tree)
+{
+    apvts.replaceState(tree);
+    publishUserCurve(getUserCurve());
+}
+
+ChainSettings BitCrusherAudioProcessor::readChainSettings() noexcept
+{
+    ChainSettings settings;
+
+    settings.bitSteps = bitStepsParam->load();
+    settings.dryWetMix = dryWetMixParam->load();
+    settings.stepMode = static_cast<Crusher::StepMode>(juce::roundToInt(stepModeParam->load()));
+    settings.autoGain = autoGainParam->load() > 0.5f;
+    settings.bypass = bypassParam->load() > 0.5f;
+    settings.oversampling = juce::roundToInt(oversamplingParam->load());
+    settings.oversamplingFilter = static_cast<OversamplingFilter>(juce::roundToInt(oversamplingFilterParam->load()));
+    settings.antialiasing = static_cast<Crusher::AntialiasingMode>(juce::roundToInt(antialiasingParam->load()));
+    settings.downsample = downsampleParam->load();
+    settings.jitter = jitterParam->load();
+    settings.downsampleSmoothing = downsampleSmoothingParam->load() > 0.5f;
+    settings.dither = static_cast<Crusher::DitherMode>(juce::roundToInt(ditherParam->load()));
+    settings.noiseShaping = juce::roundToInt(noiseShapingParam->load());
+    settings.curve = static_cast<Crusher::CurveType>(juce::roundToInt(curveParam->load()));
+
+    for (size_t lfo = 0; lfo < settings.lfoShapes.size(); ++lfo)
+    {
+        settings.lfoShapes[lfo] = static_cast<Crusher::LfoShape>(juce::roundToInt(lfoShapeParams[lfo]->load()));
+        settings.lfoRates[lfo] = lfoRateParams[lfo]->load();
+    }
+
+    settings.envelopeAttack = envelopeAttackParam->load();
+    settings.envelopeRelease = envelopeReleaseParam->load();
+    settings.stepsModSource = static_cast<Crusher::ModSource>(juce::roundToInt(stepsModSourceParam->load()));
+    settings.stepsModDepth = stepsModDepthParam->load();
+    settings.mixModSource = static_cast<Crusher::ModSource>(juce::roundToInt(mixModSourceParam->load()));
+    settings.mixModDepth = mixModDepthParam->load();
+    settings.numBands = juce::roundToInt(bandsParam->load()) + 1;
+
+    for (size_t crossover = 0; crossover < settings.crossoverFrequencies.size(); ++crossover)
+        settings.crossoverFrequencies[crossover] = crossoverParams[crossover]->load();
+
+    for (size_t band = 0; band < settings.bandBitSteps.size(); ++band)
+    {
+        settings.bandBitSteps[band] = bandBitStepsParams[band]->load();
+        settings.bandDryWetMix[band] = bandDryWetMixParams[band]->load();
+    }
+
+    // The crossover knobs can be set in any order, the splits need them ascending
+    std::sort(settings.crossoverFrequencies.begin(), settings.crossoverFrequencies.end());
+
+    settings.channelMode = static_cast<ChannelMode>(juce::roundToInt(channelModeParam->load()));
+    settings.secondBitSteps = secondBitStepsParam->load();
+    settings.secondDryWetMix = secondDryWetMixParam->load();
+
+    if (morphEnabledParam->load() > 0.5f)
+    {
+        const auto& pair = morphSnapshots.acquire();
+        auto bypass = settings.bypass;
+
+        settings = morphChainSettings(pair.a, pair.b, morphParam->load());
+        settings.bypass = bypass;
+    }
+
+    return settings;
+}
+
+/** Builds the settings from getValue(paramID), which returns that parameter's plain value. */
+template <typename GetValue>
+static ChainSettings buildChainSettings(GetValue&& getValue)
+{
+    ChainSettings settings;
+
+    settings.bitSteps = getValue("Bit Steps");
+    settings.dryWetMix = getValue("Dry Wet Mix");
+    settings.stepMode = static_cast<Crusher::StepMode>(juce::roundToInt(getValue("Step Mode")));
+    settings.autoGain = getValue("Auto Gain") > 0.5f;
+    settings.bypass = getValue("Bypass") > 0.5f;
+    settings.oversampling = juce::roundToInt(getValue("Oversampling"));
+    settings.oversamplingFilter = static_cast<OversamplingFilter>(juce::roundToInt(getValue("Oversampling Filter")));
+    settings.antialiasing = static_cast<Crusher::AntialiasingMode>(juce::roundToInt(getValue("Antialiasing")));
+    settings.downsample = getValue("Downsample");
+    settings.jitter = getValue("Jitter");
+    settings.downsampleSmoothing = getValue("Downsample Smoothing") > 0.5f;
+    settings.dither = static_cast<Crusher::DitherMode>(juce::roundToInt(getValue("Dither")));
+    settings.noiseShaping = juce::roundToInt(getValue("Noise Shaping"));
+    settings.curve = static_cast<Crusher::CurveType>(juce::roundToInt(getValue("Quantization Curve")));
+
+    for (size_t lfo = 0; lfo < settings.lfoShapes.size(); ++lfo)
+    {
+        auto prefix = "LFO " + juce::String(lfo + 1);
+        settings.lfoShapes[lfo] = static_cast<Crusher::LfoShape>(juce::roundToInt(getValue(prefix + " Shape")));
+        settings.lfoRates[lfo] = getValue(prefix + " Rate");
+    }
+
+    settings.envelopeAttack = getValue("Envelope Attack");
+    settings.envelopeRelease = getValue("Envelope Release");
+    settings.stepsModSource = static_cast<Crusher::ModSource>(juce::roundToInt(getValue("Steps Mod Source")));
+    settings.stepsModDepth = getValue("Steps Mod Depth");
+    settings.mixModSource = static_cast<Crusher::ModSource>(juce::roundToInt(getValue("Mix Mod Source")));
+    settings.mixModDepth = getValue("Mix Mod Depth");
+    settings.numBands = juce::roundToInt(getValue("Bands")) + 1;
+
+    for (size_t crossover = 0; crossover < settings.crossoverFrequencies.size(); ++crossover)
+        settings.crossoverFrequencies[crossover] = getValue("Crossover " + juce::String(crossover + 1));
+
+    for (size_t band = 0; band < settings.bandBitSteps.size(); ++band)
+    {
+        auto prefix = "Band " + juce::String(band + 1);
+        settings.bandBitSteps[band] = getValue(prefix + " Bit Steps");
+        settings.bandDryWetMix[band] = getValue(prefix + " Dry Wet Mix");
+    }
+
+    std::sort(settings.crossoverFrequencies.begin(), settings.crossoverFrequencies.end());
+
+    settings.channelMode = static_cast<ChannelMode>(juce::roundToInt(getValue("Channel Mode")));
+    settings.secondBitSteps = getValue("Bit Steps 2");
+    settings.secondDryWetMix = getValue("Dry Wet Mix 2");
+
+    return settings;
+}
+
+ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
+{
+    return buildChainSettings([&apvts](const juce::String& paramID) { return apvts.getRawParameterValue(paramID)->load(); });
+}
+
+/** Hands every setting but Bypass to set(paramID, plainValue). */
+template <typename SetValue>
+static void forEachChainSetting(const ChainSettings& settings, SetValue&& set)
+{
+    set("Bit Steps", settings.bitSteps);
+    set("Dry Wet Mix", settings.dryWetMix);
+    set("Step Mode", (float) settings.stepMode);
+    set("Auto Gain", settings.autoGain ? 1.f : 0.f);
+    set("Oversampling", (float) settings.oversampling);
+    set("Oversampling Filter", (float) settings.oversamplingFilter);
+    set("Antialiasing", (float) settings.antialiasing);
+    set("Downsample", settings.downsample);
+    set("Jitter", settings.jitter);
+    set("Downsample Smoothing", settings.downsampleSmoothing ? 1.f : 0.f);
+    set("Dither", (float) settings.dither);
+    set("Noise Shaping", (float) settings.noiseShaping);
+    set("Quantization Curve", (float) settings.curve);
+
+    for (size_t lfo = 0; lfo < settings.lfoShapes.size(); ++lfo)
+    {
+        auto prefix = "LFO " + juce::String(lfo + 1);
+        set(prefix + " Shape", (float) settings.lfoShapes[lfo]);
+        set(prefix + " Rate", settings.lfoRates[lfo]);
+    }
+
+    set("Envelope Attack", settings.envelopeAttack);
+    set("Envelope Release", settings.envelopeRelease);
+    set("Steps Mod Source", (float) settings.stepsModSource);
+    set("Steps Mod Depth", settings.stepsModDepth);
+    set("Mix Mod Source", (float) settings.mixModSource);
+    set("Mix Mod Depth", settings.mixModDepth);
+    set("Bands", (float) (settings.numBands - 1));
+
+    for (size_t crossover = 0; crossover < settings.crossoverFrequencies.size(); ++crossover)
+        set("Crossover " + juce::String(crossover + 1), settings.crossoverFrequencies[crossover]);
+
+    for (size_t band = 0; band < settings.bandBitSteps.size(); ++band)
+    {
+        auto prefix = "Band " + juce::String(band + 1);
+        set(prefix + " Bit Steps", settings.bandBitSteps[band]);
+        set(prefix + " Dry Wet Mix", settings.bandDryWetMix[band]);
+    }
+
+    set("Channel Mode", (float) settings.channelMode);
+    set("Bit Steps 2", settings.secondBitSteps);
+    set("Dry Wet Mix 2", settings.secondDryWetMix);
+}
+
+void applyChainSettings(juce::AudioProcessorValueTreeState& apvts, const ChainSettings& settings)
+{
+    forEachChainSetting(settings, [&apvts](const juce::String& paramID, float value)
+    {
+        auto* param = apvts.getParameter(paramID);
+        param->setValueNotifyingHost(param->convertTo0to1(value));
+    });
+}
+
+std::vector<float> BitCrusherAudioProcessor::getParameterValues(const ChainSettings& settings) const
+{
+    std::vector<float> values;
+
+    for (auto* parameter : getParameters())
+        values.push_back(parameter->getDefaultValue());
+
+    forEachChainSetting(settings, [this, &values](const juce::String& paramID, float value)
+    {
+        auto* param = apvts.getParameter(paramID);
+        values[(size_t) param->getParameterIndex()] = param->convertTo0to1(value);
+    });
+
+    return values;
+}
+
+ChainSettings BitCrusherAudioProcessor::getSettingsFromValues(const std::vector<float>& values) const
+{
+    return buildChainSettings([this, &values](const juce::String& paramID)
+    {
+        auto* param = apvts.getParameter(paramID);
+        auto index = (size_t) param->getParameterIndex();
+        auto value = param->getDefaultValue();
+
+        if (index < values.size() && std::isfinite(values[index]))
+            value = juce::jlimit(0.f, 1.f, values[index]);
+
+        return param->convertFrom0to1(value);
+    });
+}
+
+ChainSettings morphChainSettings(const ChainSettings& a, const ChainSettings& b, float amount) noexcept
+{
+    amount = juce::jlimit(0.f, 1.f, amount);
+
+    // Modes can't be blended, so they switch half way; the rest glides in between
+    auto settings = amount < 0.5f ? a : b;
+    settings.bypass = a.bypass;
+    settings.bitSteps = a.bitSteps + amount * (b.bitSteps - a.bitSteps);
+    settings.dryWetMix = a.dryWetMix + amount * (b.dryWetMix - a.dryWetMix);
+    settings.jitter = a.jitter + amount * (b.jitter - a.jitter);
+    settings.stepsModDepth = a.stepsModDepth + amount * (b.stepsModDepth - a.stepsModDepth);
+    settings.mixModDepth = a.mixModDepth + amount * (b.mixModDepth - a.mixModDepth);
+    settings.secondBitSteps = a.secondBitSteps + amount * (b.secondBitSteps - a.secondBitSteps);
+    settings.secondDryWetMix = a.secondDryWetMix + amount * (b.secondDryWetMix - a.secondDryWetMix);
+
+    // The hold time is heard as a rate, so it glides geometrically
+    settings.downsample = a.downsample * std::pow(b.downsample / a.downsample, amount);
+
+    for (size_t band = 0; band < settings.bandBitSteps.size(); ++band)
+    {
+        settings.bandBitSteps[band] = a.bandBitSteps[band] + amount * (b.bandBitSteps[band] - a.bandBitSteps[band]);
+        settings.bandDryWetMix[band] = a.bandDryWetMix[band] + amount * (b.bandDryWetMix[band] - a.bandDryWetMix[band]);
+    }
+
+    // So do the crossovers, being heard on a log scale as well
+    for (size_t crossover = 0; crossover < settings.crossoverFrequencies.size(); ++crossover)
+        settings.crossoverFrequencies[crossover] = a.crossoverFrequencies[crossover]
+            * std::pow(b.crossoverFrequencies[crossover] / a.crossoverFrequencies[crossover], amount);
+
+    return settings;
+}
+
+juce::AudioProcessorValueTreeState::ParameterLayout BitCrusherAudioProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Bit Steps", "Bit Steps", juce::NormalisableRange<float>(1.0f, 32.0f, 1.f, 1.f), 16.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Dry Wet Mix", "Dry Wet Mix", juce::NormalisableRange<float>(0.00f, 1.00f, 0.01f, 1.f), 0.50f));
+    layout.add(std::make_unique<juce::AudioParameterBool>("Bypass", "Bypass", false));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling", "Oversampling", juce::StringArray{ "Off", "2x", "4x", "8x", "16x" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Oversampling Filter", "Oversampling Filter", juce::StringArray{ "Polyphase IIR", "Linear Phase FIR" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Antialiasing", "Antialiasing", juce::StringArray{ "Off", "ADAA 1st Order", "ADAA 2nd Order" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Downsample", "Downsample", juce::NormalisableRange<float>(1.0f, 64.0f, 0.01f, 0.3f), 1.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Jitter", "Jitter", juce::NormalisableRange<float>(0.00f, 1.00f, 0.01f, 1.f), 0.f));
+    layout.add(std::make_unique<juce::AudioParameterBool>("Downsample Smoothing", "Downsample Smoothing", false));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Dither", "Dither", juce::StringArray{ "Off", "Rectangular", "TPDF" }, 0));
+
+    juce::StringArray noiseShapingChoices{ "Off" };
+
+    for (int order = 1; order <= Crusher::NoiseShaper::maxOrder; ++order)
+        noiseShapingChoices.add(juce::String(order) + (order == 1 ? "st" : order == 2 ? "nd" : order == 3 ? "rd" : "th") + " Order");
+
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Noise Shaping", "Noise Shaping", noiseShapingChoices, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Step Mode", "Step Mode", juce::StringArray{ "Steps", "Bit Depth" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterBool>("Auto Gain", "Auto Gain", false));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Quantization Curve", "Quantization Curve", juce::StringArray{ "Linear", "Mu-Law", "A-Law", "Logarithmic", "User" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Morph", "Morph", juce::NormalisableRange<float>(0.00f, 1.00f, 0.01f, 1.f), 0.f));
+    layout.add(std::make_unique<juce::AudioParameterBool>("Morph Presets", "Morph Presets", false));
+
+    const juce::StringArray lfoShapes{ "Sine", "Triangle", "Sample & Hold", "Random" };
+    const juce::StringArray modSources{ "Off", "LFO 1", "LFO 2", "Envelope" };
+
+    for (int lfo = 1; lfo <= 2; ++lfo)
+    {
+        auto prefix = "LFO " + juce::String(lfo);
+        layout.add(std::make_unique<juce::AudioParameterChoice>(prefix + " Shape", prefix + " Shape", lfoShapes, 0));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + " Rate", prefix + " Rate", juce::NormalisableRange<float>(0.01f, 20.0f, 0.01f, 0.3f), 1.f));
+    }
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Envelope Attack", "Envelope Attack", juce::NormalisableRange<float>(0.1f, 500.0f, 0.1f, 0.3f), 10.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Envelope Release", "Envelope Release", juce::NormalisableRange<float>(1.0f, 2000.0f, 1.f, 0.3f), 100.f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Steps Mod Source", "Steps Mod Source", modSources, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Steps Mod Depth", "Steps Mod Depth", juce::NormalisableRange<float>(-1.00f, 1.00f, 0.01f, 1.f), 0.f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Mix Mod Source", "Mix Mod Source", modSources, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Mix Mod Depth", "Mix Mod Depth", juce::NormalisableRange<float>(-1.00f, 1.00f, 0.01f, 1.f), 0.f));
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Bands", "Bands", juce::StringArray{ "Off", "2 Bands", "3 Bands", "4 Bands" }, 0));
+
+    const std::array<float, 3> crossoverDefaults{ 200.f, 1000.f, 5000.f };
+
+    for (int crossover = 1; crossover <= 3; ++crossover)
+    {
+        auto name = "Crossover " + juce::String(crossover);
+        layout.add(std::make_unique<juce::AudioParameterFloat>(name, name, juce::NormalisableRange<float>(20.0f, 20000.0f, 1.f, 0.25f),
+                                                               crossoverDefaults[(size_t) crossover - 1]));
+    }
+
+    for (int band = 1; band <= 4; ++band)
+    {
+        auto prefix = "Band " + juce::String(band);
+        layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + " Bit Steps", prefix + " Bit Steps", juce::NormalisableRange<float>(1.0f, 32.0f, 1.f, 1.f), 16.f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(prefix + " Dry Wet Mix", prefix + " Dry Wet Mix", juce::NormalisableRange<float>(0.00f, 1.00f, 0.01f, 1.f), 0.50f));
+    }
+
+    // Bit Steps and Dry Wet Mix drive the left or mid channel; these the right or side
+    layout.add(std::make_unique<juce::AudioParameterChoice>("Channel Mode", "Channel Mode", juce::StringArray{ "Stereo Linked", "Left / Right", "Mid / Side" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Bit Steps 2", "Right / Side Bit Steps", juce::NormalisableRange<float>(1.0f, 32.0f, 1.f, 1.f), 16.f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>("Dry Wet Mix 2", "Right / Side Dry Wet Mix", juce::NormalisableRange<float>(0.00f, 1.00f, 0.01f, 1.f), 0.50f));
 
     return layout;
 }
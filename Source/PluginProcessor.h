@@ -9,22 +9,84 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "CrusherKernel.h"
+#include "StaircaseADAA.h"
+#include "SampleRateReducer.h"
+#include "Metering.h"
+#include "ScopePyramid.h"
+#include "Dither.h"
+#include "CompandingCurve.h"
+#include "PluginState.h"
+#include "SnapshotExchange.h"
+#include "Modulation.h"
+#include "Crossover.h"
+#include "BlockTiming.h"
 //==============================================================================
 /**
 */
 
+enum class OversamplingFilter
+{
+    polyphaseIIR,
+    linearPhaseFIR
+};
+
+/** How the second channel relates to the first: both crushed alike, each with
+    its own settings, or the pair crushed as mid and side. */
+enum class ChannelMode
+{
+    linked,
+    leftRight,
+    midSide
+};
+
 struct ChainSettings
 {
     float bitSteps{16.f}, dryWetMix{ 0.5f };
+    Crusher::StepMode stepMode{ Crusher::StepMode::steps };
+    bool autoGain{ false };
     bool bypass{ false };
+    int oversampling{ 0 }; // log2 of the factor, 0 is off
+    OversamplingFilter oversamplingFilter{ OversamplingFilter::polyphaseIIR };
+    Crusher::AntialiasingMode antialiasing{ Crusher::AntialiasingMode::off };
+    float downsample{ 1.f }, jitter{ 0.f };
+    bool downsampleSmoothing{ false };
+    Crusher::DitherMode dither{ Crusher::DitherMode::off };
+    int noiseShaping{ 0 }; // filter order, 0 is off
+    Crusher::CurveType curve{ Crusher::CurveType::linear };
+    std::array<Crusher::LfoShape, 2> lfoShapes{ Crusher::LfoShape::sine, Crusher::LfoShape::sine };
+    std::array<float, 2> lfoRates{ 1.f, 1.f }; // Hz
+    float envelopeAttack{ 10.f }, envelopeRelease{ 100.f }; // ms
+    Crusher::ModSource stepsModSource{ Crusher::ModSource::off }, mixModSource{ Crusher::ModSource::off };
+    float stepsModDepth{ 0.f }, mixModDepth{ 0.f }; // -1..1
+    int numBands{ 1 }; // 1 is off
+    std::array<float, 3> crossoverFrequencies{ 200.f, 1000.f, 5000.f }; // Hz, ascending
+    std::array<float, 4> bandBitSteps{ 16.f, 16.f, 16.f, 16.f };
+    std::array<float, 4> bandDryWetMix{ 0.5f, 0.5f, 0.5f, 0.5f };
+    ChannelMode channelMode{ ChannelMode::linked };
+    float secondBitSteps{ 16.f }, secondDryWetMix{ 0.5f }; // the right or side channel, unless linked
 };
 
 ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts);
 
+/** Sets the parameters to the given settings, all except Bypass. Message thread only. */
+void applyChainSettings(juce::AudioProcessorValueTreeState& apvts, const ChainSettings& settings);
+
+/** Interpolates the continuous settings and takes the others from whichever end
+    is nearer. Bypass comes from a. */
+ChainSettings morphChainSettings(const ChainSettings& a, const ChainSettings& b, float amount) noexcept;
+
+struct Preset
+{
+    juce::String name;
+    ChainSettings settings;
+};
+
 //==============================================================================
 /**
 */
-class BitCrusherAudioProcessor  : public juce::AudioProcessor
+class BitCrusherAudioProcessor  : public juce::AudioProcessor,
+                                  private juce::Timer
                             #if JucePlugin_Enable_ARA
                              , public juce::AudioProcessorARAExtension
                             #endif
@@ -43,6 +105,9 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoubleProcessing() const override;
+    juce::AudioProcessorParameter* getBypassParameter() const override;
     
 
     //==============================================================================
@@ -68,12 +133,338 @@ public:
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
+    /** Loads a whole parameter tree, as older versions saved it, and everything
+        that depends on it, such as the user curve. Message thread only.
+    */
+    void replaceState(const juce::ValueTree& tree);
+
     static juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
     juce::AudioProcessorValueTreeState apvts{ *this, nullptr, "Parameters", createParameterLayout() };
 
+    static constexpr int maxOversampling = 4; // 16x
+    static constexpr int maxNumChannels = 64; // up to 7th order ambisonics
+
+    /** Running average of what one input sample costs with the given oversampling
+        (log2 of the factor), in nanoseconds. Stays at zero until that factor has
+        been used. Safe to call from any thread.
+    */
+    float getProcessingCostNsPerSample(int oversampling) const noexcept;
+
+    /** Turns metering and the scope feed on or off; they cost nothing while off.
+        The first time it is turned on, the scope's history is allocated. Call
+        from the message thread.
+    */
+    void setMeteringEnabled(bool shouldBeEnabled);
+
+    /** Takes the oldest meter frame the audio thread has produced, if any.
+        Only one thread may call this, normally the editor's timer.
+    */
+    bool popMeterFrame(Crusher::MeterFrame& frame) noexcept;
+
+    /** Recent input and output history for the scope; read it from the message thread only. */
+    const Crusher::ScopePyramid& getScopePyramid() const noexcept { return scopePyramid; }
+
+    /** Sets the levels the User quantization curve uses, between 0 and 1 (see
+        Crusher::CompandingCurve::buildFromLevels). They are saved with the plugin
+        state. Call from the message thread; the audio thread picks them up without
+        waiting.
+    */
+    void setUserCurve(const juce::Array<float>& levels);
+    juce::Array<float> getUserCurve() const;
+
+    /** Goes up by one whenever the user curve's levels may have changed, so the
+        editor only has to fetch them (which allocates) when they have. Message
+        thread only.
+    */
+    int getUserCurveRevision() const noexcept { return userCurveRevision; }
+
+    /** How much work silence has saved since the plugin was created. A host block
+        is idle when its input is all zeros and the processing tail has died away
+        below -120 dBFS; it is then cleared without running anything. Otherwise
+        every sub-block counts once per channel, as skipped when that channel was
+        all zeros on its way into a quantizer that turns zeros into zeros.
+    */
+    struct SilenceStats
+    {
+        juce::uint64 idleBlocks = 0, processedBlocks = 0;
+        juce::uint64 skippedChannelBlocks = 0, processedChannelBlocks = 0;
+    };
+
+    /** Safe to call from any thread. */
+    SilenceStats getSilenceStats() const noexcept;
+
+   #if CRUSHER_BLOCK_TIMING
+    /** How long every processBlock call has taken; see Crusher::BlockTiming. */
+    Crusher::BlockTiming& getBlockTiming() noexcept { return blockTiming; }
+   #endif
+
+    //==============================================================================
+    /** An in-memory bank of presets, exposed to the host as programs. Recalling one
+        sets the parameters, which then glide there like any other change.
+
+        For switching without touching the parameters, two snapshots, A and B, can
+        be loaded from the bank or captured from the current settings. While Morph
+        Presets is on, everything but Bypass comes from a blend of the two set by
+        the Morph parameter, worked out on the audio thread from a lock-free copy.
+
+        The bank, the current preset and the A/B pair are saved with the plugin's
+        state. All of these are for the message thread.
+    */
+    static constexpr int numPresets = 8;
+    static constexpr int numFactoryPresets = 5; // the rest are user slots
+
+    enum class MorphSlot { a, b };
+
+    void storePreset(int index, const juce::String& name);
+    const Preset& getPreset(int index) const;
+
+    void loadMorphSlot(MorphSlot slot, int presetIndex);
+    void captureMorphSlot(MorphSlot slot);
     
 
 private:
+    static constexpr double smoothingTimeSeconds = 0.02;
+    static constexpr double bypassFadeSeconds = 0.01;
+    static constexpr float silenceThreshold = 1.0e-6f; // -120 dBFS, for the tail only: inputs must be exactly zero
+    static constexpr float maxStepsModulationBits = 4.f; // full depth moves the step count by this many octaves
+    static constexpr int maxChunkSize = 512;
+
+    ChainSettings readChainSettings() noexcept;
+
+    // Both precisions share these; the host's choice only picks the instantiation
+    template <typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer, juce::MidiBuffer& midiMessages);
+    template <typename SampleType>
+    void processSubBlock(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples,
+                         const ChainSettings& chainSettings, int numChannels);
+    template <typename SampleType>
+    void quantizeBlock(juce::dsp::AudioBlock<SampleType>& block, const ChainSettings& chainSettings);
+    template <typename SampleType>
+    void quantizeBands(juce::dsp::AudioBlock<SampleType>& block, const ChainSettings& chainSettings,
+                       const bool* silent, std::array<bool, 3>& modulationRendered);
+    template <typename SampleType>
+    void modulateRamps(const juce::dsp::AudioBlock<SampleType>& block, const ChainSettings& chainSettings,
+                       float* stepsRamp, float* wetRamp, std::array<bool, 3>& rendered);
+
+    static bool isModulated(const ChainSettings& chainSettings) noexcept;
+
+    /** In place, between a left/right pair and mid = (l + r) / 2, side = (l - r) / 2.
+        Only for the paths the fused mid/side kernel doesn't cover. */
+    template <typename SampleType>
+    static void encodeMidSide(SampleType* left, SampleType* right, int numSamples) noexcept;
+    template <typename SampleType>
+    static void decodeMidSide(SampleType* mid, SampleType* side, int numSamples) noexcept;
+    template <typename SampleType>
+    void compensateBlock(juce::dsp::AudioBlock<SampleType>& block, const ChainSettings& chainSettings);
+
+    template <typename SampleType>
+    void crossfadeBypass(juce::AudioBuffer<SampleType>& buffer, int startSample, int numSamples,
+                         const ChainSettings& chainSettings, int numChannels);
+
+    static float getCompensationTarget(const ChainSettings& chainSettings) noexcept;
+    static bool isEffectivelyBypassed(const ChainSettings& chainSettings) noexcept;
+
+    /** True when no sample's magnitude is above the threshold. */
+    template <typename SampleType>
+    static bool isSilent(const SampleType* data, int numSamples, float threshold) noexcept;
+    template <typename SampleType>
+    static bool isSilent(const juce::AudioBuffer<SampleType>& buffer, int numChannels, float threshold) noexcept;
+    void jumpToTargets(const ChainSettings& chainSettings);
+    void resetProcessingState();
+
+    void setActiveOversampling(int oversampling, OversamplingFilter filter);
+
+    // Cached so processBlock never looks parameters up by their string ID
+    std::atomic<float>* bitStepsParam = nullptr;
+    std::atomic<float>* dryWetMixParam = nullptr;
+    std::atomic<float>* stepModeParam = nullptr;
+    std::atomic<float>* autoGainParam = nullptr;
+    std::atomic<float>* bypassParam = nullptr;
+    std::atomic<float>* oversamplingParam = nullptr;
+    std::atomic<float>* oversamplingFilterParam = nullptr;
+    std::atomic<float>* antialiasingParam = nullptr;
+    std::atomic<float>* downsampleParam = nullptr;
+    std::atomic<float>* jitterParam = nullptr;
+    std::atomic<float>* downsampleSmoothingParam = nullptr;
+    std::atomic<float>* ditherParam = nullptr;
+    std::atomic<float>* noiseShapingParam = nullptr;
+    std::atomic<float>* curveParam = nullptr;
+    std::atomic<float>* morphParam = nullptr;
+    std::array<std::atomic<float>*, 2> lfoShapeParams{}, lfoRateParams{};
+    std::atomic<float>* envelopeAttackParam = nullptr;
+    std::atomic<float>* envelopeReleaseParam = nullptr;
+    std::atomic<float>* stepsModSourceParam = nullptr;
+    std::atomic<float>* stepsModDepthParam = nullptr;
+    std::atomic<float>* mixModSourceParam = nullptr;
+    std::atomic<float>* mixModDepthParam = nullptr;
+    std::atomic<float>* bandsParam = nullptr;
+    std::array<std::atomic<float>*, 3> crossoverParams{};
+    std::array<std::atomic<float>*, 4> bandBitStepsParams{}, bandDryWetMixParams{};
+    std::atomic<float>* channelModeParam = nullptr;
+    std::atomic<float>* secondBitStepsParam = nullptr;
+    std::atomic<float>* secondDryWetMixParam = nullptr;
+    std::atomic<float>* morphEnabledParam = nullptr;
+
+    // The step count glides geometrically, so switching between steps and bit
+    // depth (say 16 to 32768) sweeps smoothly through every resolution in between
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> bitStepsSmoothed;
+    juce::SmoothedValue<float> dryWetMixSmoothed, compensationSmoothed;
+    Crusher::Coefficients coefficients;
+
+    // The same again for the right or side channel when the channels aren't linked
+    juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative> secondBitStepsSmoothed;
+    juce::SmoothedValue<float> secondDryWetMixSmoothed;
+    Crusher::Coefficients secondCoefficients;
+
+    // 0 while processing, 1 once bypassed; in between, the output crossfades
+    // from the processed signal to the dry input, delayed by the same latency
+    juce::SmoothedValue<float> bypassFade;
+    bool fullyBypassed = false;
+    juce::AudioBuffer<float> floatDryBuffer;
+    juce::AudioBuffer<double> doubleDryBuffer;
+    alignas(64) std::array<float, maxChunkSize> fadeWetRamp{}, fadeDryRamp{};
+
+    alignas(64) std::array<float, maxChunkSize> bitStepsRamp{}, wetRamp{}, compensationRamp{};
+    alignas(64) std::array<float, maxChunkSize> secondBitStepsRamp{}, secondWetRamp{};
+
+    const Crusher::Kernel<float>* floatKernel = nullptr;
+    const Crusher::Kernel<double>* doubleKernel = nullptr;
+
+    template <typename SampleType>
+    struct OversamplerBank
+    {
+        using Oversampler = juce::dsp::Oversampling<SampleType>;
+
+        void prepare(size_t numChannels);
+        void release();
+
+        /** Makes the given factor and filter current, resets it and returns its latency. */
+        double select(int oversampling, OversamplingFilter filter);
+
+        /** The longest latency of any factor and filter, rounded up. */
+        int getMaxLatency() const;
+
+        /** How long an impulse takes to die away below the silence threshold
+            through the filters alone, in samples at the host rate. */
+        static int measureTail(Oversampler& oversampler);
+
+        // One per factor for each filter type, indexed [filter * maxOversampling + factor - 1]
+        std::array<std::unique_ptr<Oversampler>, 2 * maxOversampling> oversamplers;
+        std::array<int, 2 * maxOversampling> tailSamples{};
+        Oversampler* active = nullptr;
+        int activeTailSamples = 0;
+    };
+
+    // Only the bank for the host's processing precision is built
+    OversamplerBank<float> floatOversamplers;
+    OversamplerBank<double> doubleOversamplers;
+    int activeOversampling = 0;
+    OversamplingFilter activeOversamplingFilter = OversamplingFilter::polyphaseIIR;
+
+    // The audio thread switches oversampling straight away and works with the new
+    // latency and tail from then on; the host only hears about the latency from
+    // timerCallback, since setLatencySamples calls back into it
+    int activeLatencySamples = 0, activeTailSamples = 0;
+    std::atomic<int> latencyToReport{ 0 };
+
+    void timerCallback() override;
+
+    /** Holds the dry input back by the reported latency, so the bypassed output
+        and the bypass crossfade line up with the processed signal. It's fed every
+        block that isn't idle, so it's already full when a fade starts. */
+    template <typename SampleType>
+    struct DryDelay
+    {
+        void prepare(int numChannels, int maxDelaySamples);
+        void reset();
+
+        /** Feeds numSamples of each channel in and writes out what went in delaySamples
+            earlier. The source and destination may be the same buffer. */
+        void process(const juce::AudioBuffer<SampleType>& source, int sourceStart,
+                     juce::AudioBuffer<SampleType>& destination, int destinationStart,
+                     int numChannels, int numSamples, int delaySamples) noexcept;
+
+        juce::AudioBuffer<SampleType> lines;
+        int writePosition = 0;
+        int mask = 0;
+    };
+
+    DryDelay<float> floatDryDelay;
+    DryDelay<double> doubleDryDelay;
+
+    std::vector<Crusher::StaircaseADAA> adaaStates;
+    Crusher::AntialiasingMode activeAntialiasing = Crusher::AntialiasingMode::off;
+
+    // One generator and one shaper per channel
+    std::vector<Crusher::DitherNoise> ditherNoise;
+    std::vector<Crusher::NoiseShaper> noiseShapers;
+    int activeNoiseShaping = 0;
+    alignas(64) std::array<float, maxChunkSize> ditherBuffer{};
+
+    // Mu-law, A-law and logarithmic never change, so they are built once here;
+    // the user curve is rebuilt on the message thread whenever its levels change
+    std::array<Crusher::CompandingCurve, 3> builtInCurves;
+    Crusher::SnapshotExchange<Crusher::CompandingCurve> userCurve;
+    int userCurveRevision = 0;
+
+    void publishUserCurve(const juce::Array<float>& levels);
+
+    const Crusher::CompandingCurve& getCurve(Crusher::CurveType type) noexcept;
+
+    // The modulators run at the processing rate and only when something is routed to them
+    std::array<Crusher::Lfo, 2> lfos;
+    Crusher::EnvelopeFollower envelopeFollower;
+    alignas(64) std::array<std::array<float, maxChunkSize>, 3> modulationBuffers{}; // LFO 1, LFO 2, envelope
+
+    // Multiband: the crossover for the host's precision and a Bit Steps and mix smoother per band
+    Crusher::LinkwitzRileyCrossover<float> floatCrossover;
+    Crusher::LinkwitzRileyCrossover<double> doubleCrossover;
+    static constexpr int maxBands = Crusher::LinkwitzRileyCrossover<float>::maxBands;
+    std::array<juce::SmoothedValue<float, juce::ValueSmoothingTypes::Multiplicative>, maxBands> bandStepsSmoothed;
+    std::array<juce::SmoothedValue<float>, maxBands> bandMixSmoothed;
+    std::array<Crusher::Coefficients, maxBands> bandCoefficients;
+
+    Crusher::SampleRateReducer sampleRateReducer;
+    static_assert(Crusher::SampleRateReducer::maxBlockSize >= maxChunkSize, "sub-blocks must fit the reducer");
+
+    Crusher::BlockMeter blockMeter;
+    Crusher::MeterFifo meterFifo;
+    Crusher::ScopePyramid scopePyramid;
+    std::atomic<bool> meteringEnabled{ false };
+    bool meteringBlock = false; // meteringEnabled, latched for the current block
+
+    std::array<Preset, numPresets> presets;
+    int currentPreset = 0;
+
+    // The message thread's copy of the A and B snapshots, and the one the audio thread reads
+    struct MorphPair
+    {
+        ChainSettings a, b;
+    };
+
+    MorphPair morphPair;
+    Crusher::SnapshotExchange<MorphPair> morphSnapshots;
+
+    void publishMorphPair();
+
+    /** Between settings and the normalised parameter values the state blob keeps
+        presets in; parameters the settings don't cover take their defaults. */
+    std::vector<float> getParameterValues(const ChainSettings& settings) const;
+    ChainSettings getSettingsFromValues(const std::vector<float>& values) const;
+
+    int silentOutputSamples = 0; // how long the input and the output have both been silent
+    bool idle = false; // idle blocks are being cleared without processing
+    std::atomic<juce::uint64> idleBlocks{ 0 }, processedBlocks{ 0 };
+    std::atomic<juce::uint64> skippedChannelBlocks{ 0 }, processedChannelBlocks{ 0 };
+
+    double currentSampleRate = 44100.0;
+    std::atomic<double> tailLengthSeconds{ 0.0 };
+    std::array<std::atomic<float>, maxOversampling + 1> processingCost{};
+
+   #if CRUSHER_BLOCK_TIMING
+    Crusher::BlockTiming blockTiming;
+   #endif
+
     //==============================================================================
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (BitCrusherAudioProcessor)
 };
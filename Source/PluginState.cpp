@@ -0,0 +1,213 @@
+/*
+  ==============================================================================
+
+    Compact binary plugin state, with a fallback to the older ValueTree blobs.
+
+  ==============================================================================
+*/
+
+#include "PluginState.h"
+
+namespace Crusher
+{
+
+namespace
+{
+    constexpr size_t headerSize = sizeof (juce::uint32) + 2 * sizeof (juce::uint16);
+
+    /** Reads sequentially from a blob, failing instead of running off its end. */
+    struct Reader
+    {
+        const char* pos;
+        const char* end;
+
+        bool canRead (size_t numBytes) const noexcept { return (size_t) (end - pos) >= numBytes; }
+
+        juce::uint16 readShort() noexcept
+        {
+            auto value = juce::ByteOrder::littleEndianShort (pos);
+            pos += sizeof (juce::uint16);
+            return value;
+        }
+
+        void readFloats (float* dest, size_t count) noexcept
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto bits = juce::ByteOrder::littleEndianInt (pos + i * sizeof (float));
+                std::memcpy (dest + i, &bits, sizeof (float));
+            }
+
+            pos += count * sizeof (float);
+        }
+
+        /** A count followed by that many floats. */
+        bool readValues (std::vector<float>& dest)
+        {
+            if (! canRead (sizeof (juce::uint16)))
+                return false;
+
+            auto count = (size_t) readShort();
+
+            if (! canRead (count * sizeof (float)))
+                return false;
+
+            dest.resize (count);
+            readFloats (dest.data(), count);
+            return true;
+        }
+
+        /** A byte count followed by that many bytes of UTF-8. */
+        bool readString (juce::String& dest)
+        {
+            if (! canRead (sizeof (juce::uint16)))
+                return false;
+
+            auto numBytes = (size_t) readShort();
+
+            if (! canRead (numBytes))
+                return false;
+
+            dest = juce::String::fromUTF8 (pos, (int) numBytes);
+            pos += numBytes;
+            return true;
+        }
+    };
+
+    constexpr size_t maxCount = std::numeric_limits<juce::uint16>::max();
+
+    void writeValues (juce::MemoryOutputStream& out, const std::vector<float>& values)
+    {
+        auto count = juce::jmin (values.size(), maxCount);
+        out.writeShort ((short) count);
+
+        for (size_t i = 0; i < count; ++i)
+            out.writeFloat (values[i]);
+    }
+}
+
+//==============================================================================
+PluginState PluginState::capture (const juce::Array<juce::AudioProcessorParameter*>& parameters,
+                                  const juce::Array<float>& userCurve)
+{
+    PluginState state;
+    state.parameterValues.reserve ((size_t) parameters.size());
+
+    for (auto* parameter : parameters)
+        state.parameterValues.push_back (parameter->getValue());
+
+    state.userCurve = userCurve;
+    return state;
+}
+
+void PluginState::applyTo (const juce::Array<juce::AudioProcessorParameter*>& parameters) const
+{
+    for (int i = 0; i < parameters.size(); ++i)
+    {
+        auto* parameter = parameters.getUnchecked (i);
+        auto value = parameter->getDefaultValue();
+
+        if ((size_t) i < parameterValues.size() && std::isfinite (parameterValues[(size_t) i]))
+            value = juce::jlimit (0.f, 1.f, parameterValues[(size_t) i]);
+
+        if (parameter->getValue() != value)
+            parameter->setValueNotifyingHost (value);
+    }
+}
+
+void PluginState::write (juce::MemoryBlock& dest) const
+{
+    auto numParameters = juce::jmin (parameterValues.size(), maxCount);
+    auto numLevels = juce::jmin (userCurve.size(), (int) maxCount);
+    auto numPresets = juce::jmin (presets.size(), maxCount);
+
+    // Presets and snapshots are a parameter set each, plus a little for the names
+    dest.ensureSize (headerSize + (numParameters * (numPresets + 3) + 1 + (size_t) numLevels) * sizeof (float)
+                                + numPresets * 32);
+
+    // MemoryOutputStream writes little-endian, whatever the platform
+    juce::MemoryOutputStream out (dest, false);
+    out.writeInt ((int) magic);
+    out.writeShort ((short) currentVersion);
+    out.writeShort ((short) numParameters);
+
+    for (size_t i = 0; i < numParameters; ++i)
+        out.writeFloat (parameterValues[i]);
+
+    out.writeShort ((short) numLevels);
+
+    for (int i = 0; i < numLevels; ++i)
+        out.writeFloat (userCurve.getUnchecked (i));
+
+    out.writeShort ((short) juce::jlimit (0, (int) maxCount, currentPreset));
+    out.writeShort ((short) numPresets);
+
+    for (size_t i = 0; i < numPresets; ++i)
+    {
+        auto name = presets[i].name.toUTF8();
+        auto numBytes = juce::jmin (std::strlen (name), maxCount);
+
+        out.writeShort ((short) numBytes);
+        out.write (name, numBytes);
+        writeValues (out, presets[i].parameterValues);
+    }
+
+    writeValues (out, morphA);
+    writeValues (out, morphB);
+}
+
+bool PluginState::isBinary (const void* data, size_t size) noexcept
+{
+    return size >= headerSize && juce::ByteOrder::littleEndianInt (data) == magic;
+}
+
+bool PluginState::read (const void* data, size_t size, PluginState& result)
+{
+    if (! isBinary (data, size))
+        return false;
+
+    Reader reader { static_cast<const char*> (data) + sizeof (juce::uint32), static_cast<const char*> (data) + size };
+
+    auto version = reader.readShort();
+
+    if (version < 1 || version > currentVersion)
+        return false;
+
+    auto numParameters = (size_t) reader.readShort();
+
+    if (! reader.canRead (numParameters * sizeof (float) + sizeof (juce::uint16)))
+        return false;
+
+    result.parameterValues.resize (numParameters);
+    reader.readFloats (result.parameterValues.data(), numParameters);
+
+    auto numLevels = (size_t) reader.readShort();
+
+    if (! reader.canRead (numLevels * sizeof (float)))
+        return false;
+
+    result.userCurve.resize ((int) numLevels);
+    reader.readFloats (result.userCurve.data(), numLevels);
+
+    result.presets.clear();
+    result.currentPreset = 0;
+    result.morphA.clear();
+    result.morphB.clear();
+
+    if (version < 2)
+        return true;
+
+    if (! reader.canRead (2 * sizeof (juce::uint16)))
+        return false;
+
+    result.currentPreset = (int) reader.readShort();
+    result.presets.resize ((size_t) reader.readShort());
+
+    for (auto& preset : result.presets)
+        if (! reader.readString (preset.name) || ! reader.readValues (preset.parameterValues))
+            return false;
+
+    return reader.readValues (result.morphA) && reader.readValues (result.morphB);
+}
+
+} // namespace Crusher
@@ -0,0 +1,82 @@
+/*
+  ==============================================================================
+
+    Compact binary plugin state, with a fallback to the older ValueTree blobs.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Crusher
+{
+
+//==============================================================================
+/** The plugin state as a flat little-endian record:
+
+        uint32  magic ("BCst")
+        uint16  version
+        uint16  number of parameters
+        float   each parameter's normalised value, in parameter order
+        uint16  number of user curve levels
+        float   each level
+
+    From version 2 the processor's preset bank and its A and B morph snapshots
+    follow, each as normalised values in the same parameter order:
+
+        uint16  current preset
+        uint16  number of presets, then for each one
+            uint16  length of its name in bytes, then the name as UTF-8
+            uint16  number of values, then each value as a float
+        uint16  number of values in snapshot A, then each value as a float
+        uint16  number of values in snapshot B, then each value as a float
+
+    Parameters are only ever appended to the layout, so their index is a stable
+    key: a blob from an older version restores the parameters it knows about and
+    leaves the rest at their defaults, and one from a newer version has its extra
+    values ignored. Restoring is a straight walk over the floats, with none of the
+    parsing and tree rebuilding a ValueTree blob needs.
+
+    Anything not starting with the magic number is taken to be a ValueTree blob,
+    which is what getStateInformation wrote before this format existed.
+*/
+struct PluginState
+{
+    static constexpr juce::uint32 magic = 0x74734342; // "BCst"
+    static constexpr juce::uint16 currentVersion = 2;
+
+    struct StoredPreset
+    {
+        juce::String name;
+        std::vector<float> parameterValues;
+    };
+
+    std::vector<float> parameterValues;
+    juce::Array<float> userCurve;
+
+    // Empty when read from a version 1 blob, which didn't save the bank
+    std::vector<StoredPreset> presets;
+    int currentPreset = 0;
+    std::vector<float> morphA, morphB;
+
+    /** Captures the parameters' current normalised values. */
+    static PluginState capture (const juce::Array<juce::AudioProcessorParameter*>& parameters,
+                                const juce::Array<float>& userCurve);
+
+    /** Sets every parameter, from the stored value or, when this state predates
+        it, its default. */
+    void applyTo (const juce::Array<juce::AudioProcessorParameter*>& parameters) const;
+
+    void write (juce::MemoryBlock& dest) const;
+
+    /** True if the data starts like a binary state blob. */
+    static bool isBinary (const void* data, size_t size) noexcept;
+
+    /** Reads this version or any older one; fails on anything truncated or from
+        a newer version. */
+    static bool read (const void* data, size_t size, PluginState& result);
+};
+
+} // namespace Crusher
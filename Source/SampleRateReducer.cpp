@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    Sample-and-hold sample-rate reduction for the bit crusher.
+
+  ==============================================================================
+*/
+
+#include "SampleRateReducer.h"
+
+namespace Crusher
+{
+
+void SampleRateReducer::prepare (int numChannels)
+{
+    heldValues.assign ((size_t) numChannels, 0.0);
+    smoothingStates.assign ((size_t) numChannels, 0.0);
+    reset();
+}
+
+void SampleRateReducer::reset() noexcept
+{
+    std::fill (heldValues.begin(), heldValues.end(), 0.0);
+    std::fill (smoothingStates.begin(), smoothingStates.end(), 0.0);
+    samplesUntilLatch = 0.0;
+}
+
+int SampleRateReducer::findLatchPoints (int numSamples, float holdFactor, float jitter) noexcept
+{
+    int numLatches = 0;
+    auto position = samplesUntilLatch;
+
+    while (position < numSamples)
+    {
+        latchPoints[(size_t) numLatches++] = (int) position;
+
+        auto interval = (double) holdFactor;
+
+        if (jitter > 0.f)
+            interval *= 1.0 + jitter * (random.nextDouble() - 0.5);
+
+        position += juce::jmax (1.0, interval);
+    }
+
+    samplesUntilLatch = position - numSamples;
+    return numLatches;
+}
+
+template <typename SampleType>
+void SampleRateReducer::process (juce::dsp::AudioBlock<SampleType>& block, float holdFactor, float jitter, bool smoothing) noexcept
+{
+    auto numSamples = (int) block.getNumSamples();
+    auto numChannels = juce::jmin (block.getNumChannels(), heldValues.size());
+
+    jassert (numSamples <= maxBlockSize);
+
+    auto numLatches = findLatchPoints (numSamples, holdFactor, jitter);
+
+    for (size_t channel = 0; channel < numChannels; ++channel)
+    {
+        auto* data = block.getChannelPointer (channel);
+        auto held = (SampleType) heldValues[channel];
+        auto runStart = 0;
+
+        for (int i = 0; i < numLatches; ++i)
+        {
+            auto latch = latchPoints[(size_t) i];
+
+            juce::FloatVectorOperations::fill (data + runStart, held, latch - runStart);
+            held = data[latch];
+            runStart = latch;
+        }
+
+        juce::FloatVectorOperations::fill (data + runStart, held, numSamples - runStart);
+        heldValues[channel] = held;
+    }
+
+    if (! smoothing)
+        return;
+
+    // A one-pole lowpass at the reduced Nyquist: fc = fs / (2 * holdFactor)
+    auto coefficient = (SampleType) 1 - std::exp (-juce::MathConstants<SampleType>::pi / (SampleType) holdFactor);
+
+    for (size_t channel = 0; channel < numChannels; ++channel)
+    {
+        auto* data = block.getChannelPointer (channel);
+        auto state = (SampleType) smoothingStates[channel];
+
+        for (int smp = 0; smp < numSamples; ++smp)
+        {
+            state += coefficient * (data[smp] - state);
+            data[smp] = state;
+        }
+
+        smoothingStates[channel] = state;
+    }
+}
+
+template void SampleRateReducer::process<float> (juce::dsp::AudioBlock<float>&, float, float, bool) noexcept;
+template void SampleRateReducer::process<double> (juce::dsp::AudioBlock<double>&, float, float, bool) noexcept;
+
+} // namespace Crusher
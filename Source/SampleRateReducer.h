@@ -0,0 +1,50 @@
+/*
+  ==============================================================================
+
+    Sample-and-hold sample-rate reduction for the bit crusher.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Crusher
+{
+
+//==============================================================================
+/** Holds every input sample for a fractional number of samples, optionally with
+    a randomly jittered hold time and a one-pole filter that softens the steps.
+
+    All channels share one clock, so the places where a new sample is taken are
+    worked out once per block and each channel is then just a handful of
+    vectorized fills between them.
+*/
+class SampleRateReducer
+{
+public:
+    static constexpr int maxBlockSize = 512;
+
+    void prepare (int numChannels);
+    void reset() noexcept;
+
+    /** Processes the block in place. holdFactor is the number of samples each
+        value is held for (1 means no reduction), jitter randomly varies that by
+        up to +/- half, and smoothing runs a one-pole filter tuned to the reduced
+        rate over the held signal.
+    */
+    template <typename SampleType>
+    void process (juce::dsp::AudioBlock<SampleType>& block, float holdFactor, float jitter, bool smoothing) noexcept;
+
+private:
+    int findLatchPoints (int numSamples, float holdFactor, float jitter) noexcept;
+
+    std::array<int, maxBlockSize> latchPoints{};
+    std::vector<double> heldValues, smoothingStates; // double so either precision can be held
+
+    double samplesUntilLatch = 0.0;
+    juce::Random random;
+};
+
+} // namespace Crusher
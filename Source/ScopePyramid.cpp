@@ -0,0 +1,133 @@
+/*
+  ==============================================================================
+
+    Min/max decimation pyramid feeding the editor's scope.
+
+  ==============================================================================
+*/
+
+#include "ScopePyramid.h"
+
+namespace Crusher
+{
+
+namespace
+{
+    // The reader never goes this close to the bins the writer is about to overwrite
+    constexpr int guardBins = 256;
+    constexpr int readableBins = ScopePyramid::binsPerLevel - guardBins;
+}
+
+void ScopePyramid::allocate()
+{
+    for (auto& signalLevels : levels)
+        for (auto& level : signalLevels)
+            if (level.bins.empty())
+                level.bins = std::vector<Bin> ((size_t) binsPerLevel);
+}
+
+template <typename SampleType>
+void ScopePyramid::push (Signal signal, const juce::dsp::AudioBlock<SampleType>& block) noexcept
+{
+    auto& acc = accumulators[(size_t) signal];
+    auto numSamples = (int) block.getNumSamples();
+
+    for (int pos = 0; pos < numSamples;)
+    {
+        auto count = juce::jmin (baseBinSize - acc.numSamples, numSamples - pos);
+
+        for (size_t channel = 0; channel < block.getNumChannels(); ++channel)
+        {
+            auto range = juce::FloatVectorOperations::findMinAndMax (block.getChannelPointer (channel) + pos, count);
+            acc.range.min = juce::jmin (acc.range.min, (float) range.getStart());
+            acc.range.max = juce::jmax (acc.range.max, (float) range.getEnd());
+        }
+
+        acc.numSamples += count;
+        pos += count;
+
+        if (acc.numSamples == baseBinSize)
+        {
+            commit (signal, 0, block.getNumChannels() > 0 ? acc.range : Range{});
+            acc = {};
+        }
+    }
+}
+
+void ScopePyramid::commit (Signal signal, int levelIndex, Range range) noexcept
+{
+    for (; levelIndex < numLevels; ++levelIndex)
+    {
+        auto& level = levels[(size_t) signal][(size_t) levelIndex];
+        auto index = level.numWritten.load (std::memory_order_relaxed);
+        auto& bin = level.bins[(size_t) (index % (juce::uint32) binsPerLevel)];
+
+        bin.min.store (range.min, std::memory_order_relaxed);
+        bin.max.store (range.max, std::memory_order_relaxed);
+        level.numWritten.store (index + 1, std::memory_order_release);
+
+        // Every second bin completes one bin on the level above
+        if (! level.hasPending)
+        {
+            level.pending = range;
+            level.hasPending = true;
+            return;
+        }
+
+        range = { juce::jmin (range.min, level.pending.min), juce::jmax (range.max, level.pending.max) };
+        level.hasPending = false;
+    }
+}
+
+int ScopePyramid::read (Signal signal, int samplesPerPixel, Range* dest, int numPixels) const noexcept
+{
+    numPixels = juce::jmin (numPixels, readableBins);
+    samplesPerPixel = juce::jlimit (baseBinSize, getMaxSamplesPerPixel (numPixels), samplesPerPixel);
+
+    // The coarsest level that still has at least one bin per pixel
+    auto levelIndex = 0;
+
+    while (levelIndex + 1 < numLevels && (baseBinSize << (levelIndex + 1)) <= samplesPerPixel)
+        ++levelIndex;
+
+    const auto& level = levels[(size_t) signal][(size_t) levelIndex];
+
+    if (level.bins.empty())
+        return 0;
+
+    const auto binsPerPixel = (double) samplesPerPixel / (double) (baseBinSize << levelIndex);
+
+    const auto numWritten = level.numWritten.load (std::memory_order_acquire);
+    const auto available = (int) juce::jmin (numWritten, (juce::uint32) readableBins);
+    const auto numFilled = juce::jmin (numPixels, (int) (available / binsPerPixel));
+    const auto firstBin = numWritten - (juce::uint32) std::ceil (numFilled * binsPerPixel);
+
+    for (int pixel = 0; pixel < numFilled; ++pixel)
+    {
+        auto begin = (juce::uint32) (pixel * binsPerPixel);
+        auto end = juce::jmax (begin + 1, (juce::uint32) ((pixel + 1) * binsPerPixel));
+
+        Range range { std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest() };
+
+        for (auto i = begin; i < end; ++i)
+        {
+            const auto& bin = level.bins[(size_t) ((firstBin + i) % (juce::uint32) binsPerLevel)];
+            range.min = juce::jmin (range.min, bin.min.load (std::memory_order_relaxed));
+            range.max = juce::jmax (range.max, bin.max.load (std::memory_order_relaxed));
+        }
+
+        dest[pixel] = range;
+    }
+
+    return numFilled;
+}
+
+int ScopePyramid::getMaxSamplesPerPixel (int numPixels) noexcept
+{
+    return readableBins / juce::jmax (1, numPixels) * (baseBinSize << (numLevels - 1));
+}
+
+template void ScopePyramid::push<float> (Signal, const juce::dsp::AudioBlock<float>&) noexcept;
+template void ScopePyramid::push<double> (Signal, const juce::dsp::AudioBlock<double>&) noexcept;
+
+} // namespace Crusher
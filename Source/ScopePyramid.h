@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    Min/max decimation pyramid feeding the editor's scope.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Crusher
+{
+
+//==============================================================================
+/** Keeps the recent history of the input and output signals as min/max pairs at
+    a ladder of resolutions, so a scope can draw any time span in work
+    proportional to its width instead of to the number of samples shown.
+
+    Level 0 holds one pair per baseBinSize samples; every level above merges two
+    bins of the one below. Each level is a ring of binsPerLevel pairs.
+
+    The audio thread is the only writer and the message thread the only reader.
+    Bins are relaxed atomics published through a release store of each level's
+    write count, so neither side locks, and the reader simply stays clear of the
+    oldest bins, which are the ones being overwritten.
+
+    The history takes about 320 KB, so it isn't allocated until allocate() is
+    called, normally when an editor first opens.
+*/
+class ScopePyramid
+{
+public:
+    enum Signal
+    {
+        input,
+        output,
+        numSignals
+    };
+
+    struct Range
+    {
+        float min = 0.f, max = 0.f;
+    };
+
+    static constexpr int baseBinSize = 16;
+    static constexpr int numLevels = 10;
+    static constexpr int binsPerLevel = 2048;
+
+    ScopePyramid() = default;
+
+    /** Message thread: allocates the history if it isn't already. Call it, and
+        publish the fact to the audio thread, before the first push; it is kept
+        until the pyramid is destroyed, so the writer never sees it go.
+    */
+    void allocate();
+
+    /** Audio thread: appends a block, folding all its channels together. */
+    template <typename SampleType>
+    void push (Signal signal, const juce::dsp::AudioBlock<SampleType>& block) noexcept;
+
+    /** Message thread: fills dest with the most recent numPixels columns, oldest
+        first, each covering samplesPerPixel samples. Returns how many were filled,
+        which is less than numPixels while there isn't enough history yet, and
+        none before allocate().
+    */
+    int read (Signal signal, int samplesPerPixel, Range* dest, int numPixels) const noexcept;
+
+    /** The longest span read can cover with the given number of columns. */
+    static int getMaxSamplesPerPixel (int numPixels) noexcept;
+
+private:
+    struct Bin
+    {
+        std::atomic<float> min { 0.f }, max { 0.f };
+    };
+
+    struct Level
+    {
+        std::vector<Bin> bins;
+        std::atomic<juce::uint32> numWritten { 0 };
+        Range pending;
+        bool hasPending = false;
+    };
+
+    struct Accumulator
+    {
+        Range range { std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest() };
+        int numSamples = 0;
+    };
+
+    void commit (Signal signal, int level, Range range) noexcept;
+
+    std::array<std::array<Level, numLevels>, numSignals> levels;
+    std::array<Accumulator, numSignals> accumulators;
+
+    JUCE_DECLARE_NON_COPYABLE (ScopePyramid)
+};
+
+} // namespace Crusher
@@ -0,0 +1,63 @@
+/*
+  ==============================================================================
+
+    Lock-free hand-over of whole objects from the message thread to the audio
+    thread.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Crusher
+{
+
+//==============================================================================
+/** Passes the latest version of an object from one writer thread to one reader
+    thread, typically the message thread to the audio thread.
+
+    Three copies rotate through the writer's, the reader's and a middle slot.
+    The writer fills in its own slot and swaps it into the middle with a single
+    atomic exchange; the reader swaps the middle into its own slot only when
+    something new is there. Neither side ever waits or allocates, and the reader
+    never sees a half-written object. The object the reader holds stays valid
+    until its next acquire().
+*/
+template <typename ObjectType>
+class SnapshotExchange
+{
+public:
+    SnapshotExchange() = default;
+
+    /** Writer only: the slot to fill in before publish(). It holds a stale
+        version, so overwrite all of it. */
+    ObjectType& getWriteSlot() noexcept { return objects[(size_t) writeIndex]; }
+
+    /** Writer only: hands the write slot over to the reader. */
+    void publish() noexcept
+    {
+        writeIndex = middle.exchange (writeIndex | freshBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    /** Reader only: the most recently published object. */
+    const ObjectType& acquire() noexcept
+    {
+        if ((middle.load (std::memory_order_relaxed) & freshBit) != 0)
+            readIndex = middle.exchange (readIndex, std::memory_order_acq_rel) & indexMask;
+
+        return objects[(size_t) readIndex];
+    }
+
+private:
+    static constexpr int freshBit = 4, indexMask = 3;
+
+    std::array<ObjectType, 3> objects{};
+    int writeIndex = 0, readIndex = 1;
+    std::atomic<int> middle { 2 };
+
+    JUCE_DECLARE_NON_COPYABLE (SnapshotExchange)
+};
+
+} // namespace Crusher
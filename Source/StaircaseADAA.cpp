@@ -0,0 +1,141 @@
+/*
+  ==============================================================================
+
+    Antiderivative anti-aliasing for the bit crusher's staircase.
+
+    In units of one step (u = x * bitSteps) the quantizer is g(u) = sign(u) * ceil(|u|).
+    With m = floor(|u|) its antiderivatives are
+
+        G1(u) = (m + 1) * (|u| - m / 2)
+        G2(u) = sign(u) * (m (m + 1) (2m + 1) / 12 + (m + 1) |u| (|u| - m) / 2)
+
+    and scaling back to x gives F1(x) = G1(xN) / N^2 and F2(x) = G2(xN) / N^3.
+    The dry part of the mix adds x^2 / 2 and x^3 / 6 respectively.
+
+  ==============================================================================
+*/
+
+#include "StaircaseADAA.h"
+
+namespace Crusher
+{
+
+namespace
+{
+    // Below this distance between samples the divided differences lose too much
+    // precision to be trusted, and the midpoint fallbacks take over
+    constexpr double illConditionedTolerance = 1.0e-5;
+
+    struct MixCurve
+    {
+        MixCurve (float bitSteps, float wet) noexcept
+            : steps (bitSteps), invSteps (1.0 / bitSteps), wetGain (wet), dryGain (1.0 - wet) {}
+
+        double value (double x) const noexcept
+        {
+            const auto u = x * steps;
+            return wetGain * std::copysign (std::ceil (std::abs (u)), u) * invSteps + dryGain * x;
+        }
+
+        double firstAntiderivative (double x) const noexcept
+        {
+            const auto a = std::abs (x) * steps;
+            const auto m = std::floor (a);
+
+            return wetGain * (m + 1.0) * (a - 0.5 * m) * invSteps * invSteps
+                 + dryGain * x * x * 0.5;
+        }
+
+        double secondAntiderivative (double x) const noexcept
+        {
+            const auto a = std::abs (x) * steps;
+            const auto m = std::floor (a);
+            const auto g2 = m * (m + 1.0) * (2.0 * m + 1.0) / 12.0 + 0.5 * (m + 1.0) * a * (a - m);
+
+            return wetGain * std::copysign (g2, x) * invSteps * invSteps * invSteps
+                 + dryGain * x * x * x / 6.0;
+        }
+
+        double steps, invSteps, wetGain, dryGain;
+    };
+}
+
+//==============================================================================
+void StaircaseADAA::reset() noexcept
+{
+    x1 = x2 = 0.0;
+    antiderivativeX1 = 0.0;
+    previousDifference = 0.0;
+}
+
+template <typename SampleType>
+void StaircaseADAA::process (AntialiasingMode mode, SampleType* data, int numSamples,
+                             const float* bitSteps, const float* wet, int stride) noexcept
+{
+    if (mode == AntialiasingMode::firstOrderADAA)
+        processFirstOrder (data, numSamples, bitSteps, wet, stride);
+    else if (mode == AntialiasingMode::secondOrderADAA)
+        processSecondOrder (data, numSamples, bitSteps, wet, stride);
+}
+
+template <typename SampleType>
+void StaircaseADAA::processFirstOrder (SampleType* data, int numSamples, const float* bitSteps, const float* wet, int stride) noexcept
+{
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        const MixCurve curve (bitSteps[smp * stride], wet[smp * stride]);
+
+        const auto x = (double) data[smp];
+        const auto ad1 = curve.firstAntiderivative (x);
+        const auto dx = x - x1;
+
+        const auto y = std::abs (dx) < illConditionedTolerance ? curve.value (0.5 * (x + x1))
+                                                                : (ad1 - antiderivativeX1) / dx;
+
+        x1 = x;
+        antiderivativeX1 = ad1;
+        data[smp] = (SampleType) y;
+    }
+}
+
+template <typename SampleType>
+void StaircaseADAA::processSecondOrder (SampleType* data, int numSamples, const float* bitSteps, const float* wet, int stride) noexcept
+{
+    for (int smp = 0; smp < numSamples; ++smp)
+    {
+        const MixCurve curve (bitSteps[smp * stride], wet[smp * stride]);
+
+        const auto x = (double) data[smp];
+        const auto ad2 = curve.secondAntiderivative (x);
+        const auto dx = x - x1;
+
+        const auto difference = std::abs (dx) < illConditionedTolerance ? curve.firstAntiderivative (0.5 * (x + x1))
+                                                                         : (ad2 - antiderivativeX1) / dx;
+        double y;
+
+        if (std::abs (x - x2) < illConditionedTolerance)
+        {
+            const auto xBar = 0.5 * (x + x2);
+            const auto delta = xBar - x1;
+
+            y = std::abs (delta) < illConditionedTolerance
+                  ? curve.value (0.5 * (xBar + x1))
+                  : 2.0 / delta * (curve.firstAntiderivative (xBar) + (antiderivativeX1 - curve.secondAntiderivative (xBar)) / delta);
+        }
+        else
+        {
+            y = 2.0 * (difference - previousDifference) / (x - x2);
+        }
+
+        previousDifference = difference;
+        x2 = x1;
+        x1 = x;
+        antiderivativeX1 = ad2;
+        data[smp] = (SampleType) y;
+    }
+}
+
+template void StaircaseADAA::process<float> (AntialiasingMode, float*, int, const float*, const float*, int) noexcept;
+template void StaircaseADAA::process<double> (AntialiasingMode, double*, int, const float*, const float*, int) noexcept;
+
+} // namespace Crusher
@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    Antiderivative anti-aliasing for the bit crusher's staircase.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+
+namespace Crusher
+{
+
+enum class AntialiasingMode
+{
+    off,
+    firstOrderADAA,
+    secondOrderADAA
+};
+
+//==============================================================================
+/** Runs the quantize-and-mix curve through first- or second-order antiderivative
+    anti-aliasing, for one channel.
+
+    Instead of sampling the staircase directly, each output is the average of the
+    curve over the segment between neighbouring input samples, worked out from
+    closed-form antiderivatives. That removes most of the aliasing the hard steps
+    produce at a small fraction of the cost of oversampling. The dry part of the
+    mix goes through the same process, so both stay time aligned (half a sample of
+    delay for first order, one sample for second order).
+
+    Samples closer together than the curve can be differentiated over reliably
+    fall back to evaluating the curve, or its first antiderivative, at the midpoint.
+*/
+class StaircaseADAA
+{
+public:
+    void reset() noexcept;
+
+    /** Processes one channel of float or double samples in place. bitSteps and
+        wet are read with the given stride, so a stride of 0 holds them constant
+        over the whole block.
+    */
+    template <typename SampleType>
+    void process(AntialiasingMode mode, SampleType* data, int numSamples,
+                 const float* bitSteps, const float* wet, int stride) noexcept;
+
+private:
+    template <typename SampleType>
+    void processFirstOrder(SampleType* data, int numSamples, const float* bitSteps, const float* wet, int stride) noexcept;
+    template <typename SampleType>
+    void processSecondOrder(SampleType* data, int numSamples, const float* bitSteps, const float* wet, int stride) noexcept;
+
+    double x1{ 0.0 }, x2{ 0.0 };
+    double antiderivativeX1{ 0.0 };
+    double previousDifference{ 0.0 };
+};
+
+} // namespace Crusher
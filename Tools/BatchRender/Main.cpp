@@ -0,0 +1,300 @@
+/*
+  ==============================================================================
+
+    Headless batch renderer: streams audio files through BitCrusherAudioProcessor
+    without a host.
+
+    Build it as a JUCE console application that also compiles the plugin's
+    Source/*.cpp files, with the juce_audio_formats, juce_audio_processors and
+    juce_dsp modules enabled and the JucePlugin_* macros defined the same way
+    as in the plugin project.
+
+    Usage:
+        BitCrusherBatch [--state file] [--block-size n] [--threads n]
+                        [--out-dir dir] input [input ...]
+
+    --state takes either a blob saved by getStateInformation or the same tree
+    exported as XML. Every input (WAV, AIFF or FLAC) is written next to itself,
+    or into --out-dir, with a "_crushed" suffix in its original format.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+#include <iostream>
+
+namespace
+{
+
+struct Options
+{
+    juce::File stateFile, outputDirectory;
+    int blockSize = 512;
+    int numThreads = juce::SystemStats::getNumCpus();
+    juce::Array<juce::File> inputs;
+};
+
+struct RenderResult
+{
+    juce::String error;
+    double audioSeconds = 0.0, wallSeconds = 0.0;
+};
+
+//==============================================================================
+bool parseOptions (const juce::StringArray& args, Options& options)
+{
+    for (int i = 0; i < args.size(); ++i)
+    {
+        auto arg = args[i];
+        auto hasValue = i + 1 < args.size();
+
+        if (arg == "--state" && hasValue)            options.stateFile = juce::File::getCurrentWorkingDirectory().getChildFile (args[++i]);
+        else if (arg == "--out-dir" && hasValue)     options.outputDirectory = juce::File::getCurrentWorkingDirectory().getChildFile (args[++i]);
+        else if (arg == "--block-size" && hasValue)  options.blockSize = args[++i].getIntValue();
+        else if (arg == "--threads" && hasValue)     options.numThreads = args[++i].getIntValue();
+        else if (arg.startsWith ("--"))              return false;
+        else                                         options.inputs.add (juce::File::getCurrentWorkingDirectory().getChildFile (arg));
+    }
+
+    return options.blockSize > 0 && options.numThreads > 0 && ! options.inputs.isEmpty();
+}
+
+bool loadState (BitCrusherAudioProcessor& processor, const juce::File& stateFile)
+{
+    if (stateFile.hasFileExtension ("xml"))
+    {
+        auto tree = juce::ValueTree::fromXml (stateFile.loadFileAsString());
+
+        if (! tree.isValid())
+            return false;
+
+        processor.replaceState (tree);
+        return true;
+    }
+
+    juce::MemoryBlock state;
+
+    if (! stateFile.loadFileAsData (state) || state.isEmpty())
+        return false;
+
+    processor.setStateInformation (state.getData(), (int) state.getSize());
+    return true;
+}
+
+std::unique_ptr<juce::AudioFormatReader> createReader (juce::AudioFormat& format, const juce::File& input)
+{
+    // WAV and AIFF can be mapped straight into memory, which saves a copy per chunk
+    if (std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped { format.createMemoryMappedReader (input) })
+        if (mapped->mapEntireFile())
+            return mapped;
+
+    return std::unique_ptr<juce::AudioFormatReader> (format.createReaderFor (input.createInputStream().release(), true));
+}
+
+//==============================================================================
+RenderResult renderFile (BitCrusherAudioProcessor& processor, juce::AudioFormatManager& formats,
+                         const juce::File& input, const Options& options)
+{
+    RenderResult result;
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    auto* format = formats.findFormatForFileExtension (input.getFileExtension());
+
+    if (format == nullptr)
+        return { "unsupported file type" };
+
+    auto reader = createReader (*format, input);
+
+    if (reader == nullptr)
+        return { "couldn't open file" };
+
+    auto numChannels = (int) reader->numChannels;
+    auto channelSet = juce::AudioChannelSet::canonicalChannelSet (numChannels);
+
+    juce::AudioProcessor::BusesLayout layout;
+    layout.inputBuses.add (channelSet);
+    layout.outputBuses.add (channelSet);
+
+    if (! processor.setBusesLayout (layout))
+        return { "unsupported channel layout: " + channelSet.getDescription() };
+
+    processor.setRateAndBufferSizeDetails (reader->sampleRate, options.blockSize);
+    processor.prepareToPlay (reader->sampleRate, options.blockSize);
+
+    auto outputDirectory = options.outputDirectory == juce::File() ? input.getParentDirectory() : options.outputDirectory;
+    auto outputFile = outputDirectory.getChildFile (input.getFileNameWithoutExtension() + "_crushed" + input.getFileExtension());
+    outputFile.deleteFile();
+
+    auto stream = outputFile.createOutputStream();
+
+    if (stream == nullptr)
+        return { "couldn't create " + outputFile.getFullPathName() };
+
+    std::unique_ptr<juce::AudioFormatWriter> writer (format->createWriterFor (stream.get(), reader->sampleRate,
+                                                                              (unsigned int) numChannels,
+                                                                              (int) reader->bitsPerSample,
+                                                                              reader->metadataValues, 0));
+    if (writer == nullptr)
+        return { "couldn't create a writer for " + outputFile.getFileName() };
+
+    stream.release(); // now owned by the writer
+
+    // Run the latency worth of silence through at the end and drop it from the start,
+    // so the output lines up with the input sample for sample
+    auto latency = (juce::int64) processor.getLatencySamples();
+    auto inputLength = reader->lengthInSamples;
+    auto totalLength = inputLength + latency;
+    auto samplesToSkip = latency;
+
+    juce::AudioBuffer<float> buffer (numChannels, options.blockSize);
+    juce::MidiBuffer midi;
+
+    for (juce::int64 position = 0; position < totalLength; position += options.blockSize)
+    {
+        auto numSamples = (int) juce::jmin ((juce::int64) options.blockSize, totalLength - position);
+        juce::AudioBuffer<float> chunk (buffer.getArrayOfWritePointers(), numChannels, numSamples);
+
+        chunk.clear();
+
+        if (position < inputLength)
+            reader->read (&chunk, 0, (int) juce::jmin ((juce::int64) numSamples, inputLength - position), position, true, true);
+
+        processor.processBlock (chunk, midi);
+
+        auto skip = (int) juce::jmin (samplesToSkip, (juce::int64) numSamples);
+        samplesToSkip -= skip;
+
+        if (! writer->writeFromAudioSampleBuffer (chunk, skip, numSamples - skip))
+            return { "write failed" };
+    }
+
+    processor.releaseResources();
+
+    result.audioSeconds = (double) inputLength / reader->sampleRate;
+    result.wallSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    return result;
+}
+
+//==============================================================================
+/** Each worker owns one processor and keeps taking the next unrendered file from
+    the shared list until none are left, so a worker that drew short files just
+    picks up more of them instead of sitting idle.
+*/
+class RenderWorker : public juce::Thread
+{
+public:
+    RenderWorker (BitCrusherAudioProcessor& p, const Options& o,
+                  std::atomic<int>& next, std::vector<RenderResult>& r)
+        : juce::Thread ("BitCrusher render"), processor (p), options (o), nextInput (next), results (r)
+    {
+        formats.registerBasicFormats();
+    }
+
+    void run() override
+    {
+        for (;;)
+        {
+            auto index = nextInput.fetch_add (1);
+
+            if (index >= options.inputs.size() || threadShouldExit())
+                return;
+
+            results[(size_t) index] = renderFile (processor, formats, options.inputs.getReference (index), options);
+        }
+    }
+
+private:
+    BitCrusherAudioProcessor& processor;
+    const Options& options;
+    std::atomic<int>& nextInput;
+    std::vector<RenderResult>& results;
+    juce::AudioFormatManager formats;
+};
+
+} // namespace
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add (juce::CharPointer_UTF8 (argv[i]));
+
+    Options options;
+
+    if (! parseOptions (args, options))
+    {
+        std::cerr << "Usage: BitCrusherBatch [--state file] [--block-size n] [--threads n] [--out-dir dir] input [input ...]" << std::endl;
+        return 1;
+    }
+
+    auto numWorkers = juce::jmin (options.numThreads, options.inputs.size());
+
+    // Processors are created and loaded here on the message thread, then handed
+    // to the workers, so parameter trees are never built on a render thread
+    std::vector<std::unique_ptr<BitCrusherAudioProcessor>> processors;
+
+    for (int i = 0; i < numWorkers; ++i)
+    {
+        auto processor = std::make_unique<BitCrusherAudioProcessor>();
+        processor->setNonRealtime (true);
+
+        if (options.stateFile != juce::File() && ! loadState (*processor, options.stateFile))
+        {
+            std::cerr << "Couldn't load state from " << options.stateFile.getFullPathName() << std::endl;
+            return 1;
+        }
+
+        processors.push_back (std::move (processor));
+    }
+
+    std::atomic<int> nextInput { 0 };
+    std::vector<RenderResult> results ((size_t) options.inputs.size());
+    std::vector<std::unique_ptr<RenderWorker>> workers;
+
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    for (auto& processor : processors)
+    {
+        workers.push_back (std::make_unique<RenderWorker> (*processor, options, nextInput, results));
+        workers.back()->startThread();
+    }
+
+    for (auto& worker : workers)
+        worker->waitForThreadToExit (-1);
+
+    auto wallSeconds = juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+
+    auto totalAudioSeconds = 0.0;
+    auto numFailed = 0;
+
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        auto name = options.inputs.getReference ((int) i).getFileName();
+
+        if (result.error.isNotEmpty())
+        {
+            std::cerr << name << ": " << result.error << std::endl;
+            ++numFailed;
+            continue;
+        }
+
+        totalAudioSeconds += result.audioSeconds;
+
+        std::cout << name << ": " << juce::String (result.audioSeconds, 2) << " s of audio in "
+                  << juce::String (result.wallSeconds, 3) << " s ("
+                  << juce::String (result.audioSeconds / juce::jmax (1.0e-9, result.wallSeconds), 1) << "x realtime)" << std::endl;
+    }
+
+    std::cout << "Total: " << juce::String (totalAudioSeconds, 2) << " s of audio in "
+              << juce::String (wallSeconds, 3) << " s on " << numWorkers << " threads ("
+              << juce::String (totalAudioSeconds / juce::jmax (1.0e-9, wallSeconds), 1) << "x realtime)" << std::endl;
+
+    return numFailed == 0 ? 0 : 1;
+}
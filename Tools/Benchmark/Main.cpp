@@ -0,0 +1,385 @@
+/*
+  ==============================================================================
+
+    Micro-benchmarks for BitCrusherAudioProcessor::processBlock.
+
+    Build it as a JUCE console application that also compiles the plugin's
+    Source/*.cpp files, with the juce_audio_processors and juce_dsp modules
+    enabled and the JucePlugin_* macros defined the same way as in the plugin
+    project. Build in release mode: the numbers are meaningless otherwise.
+
+    Usage:
+        BitCrusherBenchmark [--seconds s] [--sample-rate hz] [--json file]
+
+    Every combination of block size (16 to 8192), channel layout (mono and
+    stereo up to 7.1.4 and third order ambisonics), sample precision (float or
+    double), Bit Steps, Dry Wet Mix and bypass is timed over --seconds of
+    audio, and the unbypassed cases also with TPDF dither and with TPDF dither
+    plus 9th order noise shaping. Stereo is also timed in the left/right and
+    mid/side channel modes, with the right or side channel at half the Bit
+    Steps of the other. The results are printed as ns/sample, cycles/sample and realtime
+    headroom, and optionally written as JSON so runs from different builds can
+    be compared.
+
+    Before that, saving and restoring the plugin state is timed in both the
+    binary format and the older ValueTree one, as a session with many instances
+    would.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+#include <iostream>
+
+#if JUCE_INTEL
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <x86intrin.h>
+ #endif
+#endif
+
+namespace
+{
+
+struct Options
+{
+    double secondsPerCase = 0.5;
+    double sampleRate = 48000.0;
+    juce::File jsonFile;
+};
+
+struct Case
+{
+    int blockSize;
+    juce::AudioChannelSet channels;
+    juce::AudioProcessor::ProcessingPrecision precision;
+    float bitSteps, dryWetMix;
+    bool bypass;
+    int dither, noiseShaping, channelMode; // parameter choice indices
+};
+
+struct Measurement
+{
+    double nsPerSample, cyclesPerSample, headroom;
+};
+
+struct StateMeasurement
+{
+    size_t numBytes;
+    double saveMicroseconds, loadMicroseconds;
+};
+
+/** Time stamp counter on x86, zero elsewhere (cycles are then reported as 0). */
+juce::uint64 readCycleCounter() noexcept
+{
+   #if JUCE_INTEL
+    return (juce::uint64) __rdtsc();
+   #else
+    return 0;
+   #endif
+}
+
+//==============================================================================
+bool parseOptions (const juce::StringArray& args, Options& options)
+{
+    for (int i = 0; i < args.size(); ++i)
+    {
+        auto arg = args[i];
+
+        if (i + 1 >= args.size())
+            return false;
+
+        if (arg == "--seconds")           options.secondsPerCase = args[++i].getDoubleValue();
+        else if (arg == "--sample-rate")  options.sampleRate = args[++i].getDoubleValue();
+        else if (arg == "--json")         options.jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile (args[++i]);
+        else                              return false;
+    }
+
+    return options.secondsPerCase > 0.0 && options.sampleRate > 0.0;
+}
+
+void setParameter (BitCrusherAudioProcessor& processor, const juce::String& paramID, float value)
+{
+    auto* param = processor.apvts.getParameter (paramID);
+    param->setValueNotifyingHost (param->convertTo0to1 (value));
+}
+
+//==============================================================================
+template <typename SampleType>
+double timeBlocks (BitCrusherAudioProcessor& processor, const Case& c, int numBlocks, juce::uint64& cycles)
+{
+    juce::AudioBuffer<SampleType> buffer (c.channels.size(), c.blockSize);
+    juce::MidiBuffer midi;
+    juce::Random random (1234);
+
+    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        for (int smp = 0; smp < c.blockSize; ++smp)
+            buffer.setSample (channel, smp, (SampleType) (0.5f * (random.nextFloat() * 2.f - 1.f)));
+
+    // Warm up caches, branch predictors and let any parameter smoothing settle
+    for (int i = 0; i < juce::jmax (16, numBlocks / 10); ++i)
+        processor.processBlock (buffer, midi);
+
+    auto startTicks = juce::Time::getHighResolutionTicks();
+    auto startCycles = readCycleCounter();
+
+    for (int i = 0; i < numBlocks; ++i)
+        processor.processBlock (buffer, midi);
+
+    cycles = readCycleCounter() - startCycles;
+    return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+}
+
+Measurement runCase (const Case& c, const Options& options)
+{
+    BitCrusherAudioProcessor processor;
+
+    juce::AudioProcessor::BusesLayout layout;
+    layout.inputBuses.add (c.channels);
+    layout.outputBuses.add (c.channels);
+    processor.setBusesLayout (layout);
+
+    setParameter (processor, "Bit Steps", c.bitSteps);
+    setParameter (processor, "Dry Wet Mix", c.dryWetMix);
+    setParameter (processor, "Bypass", c.bypass ? 1.f : 0.f);
+    setParameter (processor, "Dither", (float) c.dither);
+    setParameter (processor, "Noise Shaping", (float) c.noiseShaping);
+    setParameter (processor, "Channel Mode", (float) c.channelMode);
+    setParameter (processor, "Bit Steps 2", juce::jmax (1.f, c.bitSteps * 0.5f));
+    setParameter (processor, "Dry Wet Mix 2", c.dryWetMix);
+
+    processor.setProcessingPrecision (c.precision);
+    processor.setRateAndBufferSizeDetails (options.sampleRate, c.blockSize);
+    processor.prepareToPlay (options.sampleRate, c.blockSize);
+
+    auto numBlocks = juce::jmax (1, (int) (options.secondsPerCase * options.sampleRate / c.blockSize));
+    juce::uint64 cycles = 0;
+
+    auto seconds = c.precision == juce::AudioProcessor::doublePrecision
+                 ? timeBlocks<double> (processor, c, numBlocks, cycles)
+                 : timeBlocks<float> (processor, c, numBlocks, cycles);
+
+    processor.releaseResources();
+
+    auto numSamples = (double) numBlocks * c.blockSize;
+    auto audioSeconds = numSamples / options.sampleRate;
+
+    return { seconds * 1.0e9 / numSamples, (double) cycles / numSamples, audioSeconds / juce::jmax (1.0e-12, seconds) };
+}
+
+//==============================================================================
+template <typename Function>
+double timeMicroseconds (int numRuns, Function&& function)
+{
+    auto startTicks = juce::Time::getHighResolutionTicks();
+
+    for (int i = 0; i < numRuns; ++i)
+        function();
+
+    return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks) * 1.0e6 / numRuns;
+}
+
+/** Saves and restores a non-default state, either as getStateInformation does or
+    as the ValueTree blobs older versions wrote, which still load through the
+    fallback path.
+
+    Restoring skips parameters that already hold the stored value, so loading the
+    same blob again and again would only time the first load properly. The loads
+    alternate between two states that differ in every parameter they set instead.
+*/
+StateMeasurement measureState (bool binary)
+{
+    constexpr int numRuns = 2000;
+
+    BitCrusherAudioProcessor processor, otherProcessor;
+    setParameter (processor, "Bit Steps", 7.f);
+    setParameter (processor, "Dry Wet Mix", 0.8f);
+    setParameter (processor, "Dither", 2.f);
+    setParameter (processor, "Quantization Curve", 4.f);
+    processor.setUserCurve ({ 0.05f, 0.1f, 0.2f, 0.4f, 0.7f });
+
+    setParameter (otherProcessor, "Bit Steps", 3.f);
+    setParameter (otherProcessor, "Dry Wet Mix", 0.3f);
+    setParameter (otherProcessor, "Dither", 1.f);
+    setParameter (otherProcessor, "Quantization Curve", 1.f);
+    otherProcessor.setUserCurve ({ 0.1f, 0.3f, 0.6f });
+
+    auto save = [binary] (BitCrusherAudioProcessor& source, juce::MemoryBlock& block)
+    {
+        block.reset();
+
+        if (binary)
+        {
+            source.getStateInformation (block);
+        }
+        else
+        {
+            juce::MemoryOutputStream out (block, false);
+            source.apvts.copyState().writeToStream (out);
+        }
+    };
+
+    juce::MemoryBlock state, otherState;
+    auto saveMicroseconds = timeMicroseconds (numRuns, [&] { save (processor, state); });
+    save (otherProcessor, otherState);
+
+    BitCrusherAudioProcessor restored;
+    int run = 0;
+
+    auto loadMicroseconds = timeMicroseconds (numRuns, [&]
+    {
+        const auto& blob = (run++ % 2 == 0) ? state : otherState;
+        restored.setStateInformation (blob.getData(), (int) blob.getSize());
+    });
+
+    return { state.getSize(), saveMicroseconds, loadMicroseconds };
+}
+
+} // namespace
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+
+    for (int i = 1; i < argc; ++i)
+        args.add (juce::CharPointer_UTF8 (argv[i]));
+
+    Options options;
+
+    if (! parseOptions (args, options))
+    {
+        std::cerr << "Usage: BitCrusherBenchmark [--seconds s] [--sample-rate hz] [--json file]" << std::endl;
+        return 1;
+    }
+
+    const int blockSizes[] = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192 };
+    const juce::AudioChannelSet layouts[] = { juce::AudioChannelSet::mono(), juce::AudioChannelSet::stereo(),
+                                              juce::AudioChannelSet::create5point1(),
+                                              juce::AudioChannelSet::create7point1point4(),
+                                              juce::AudioChannelSet::ambisonic (3) };
+    const float bitStepValues[] = { 1.f, 4.f, 16.f, 32.f };
+    const float mixValues[] = { 0.f, 0.5f, 1.f };
+    const juce::AudioProcessor::ProcessingPrecision precisions[] = { juce::AudioProcessor::singlePrecision,
+                                                                     juce::AudioProcessor::doublePrecision };
+    const std::pair<int, int> noiseSettings[] = { { 0, 0 }, { 2, 0 }, { 2, 9 } }; // off, TPDF, TPDF + 9th order
+    const char* channelModeNames[] = { "linked", "l/r", "m/s" };
+
+    // The channel modes only mean something for a stereo pair
+    std::vector<std::pair<juce::AudioChannelSet, int>> layoutModes;
+
+    for (const auto& channels : layouts)
+        for (int channelMode = 0; channelMode < (channels.size() == 2 ? 3 : 1); ++channelMode)
+            layoutModes.push_back ({ channels, channelMode });
+
+    juce::Array<juce::var> results, stateResults;
+
+    std::cout << "state      bytes  save us  load us" << std::endl;
+
+    for (auto binary : { false, true })
+    {
+        auto m = measureState (binary);
+        auto formatName = binary ? "binary" : "valuetree";
+
+        std::cout << juce::String (formatName).paddedRight (' ', 11)
+                  << juce::String ((juce::int64) m.numBytes).paddedRight (' ', 7)
+                  << juce::String (m.saveMicroseconds, 2).paddedRight (' ', 9)
+                  << juce::String (m.loadMicroseconds, 2) << std::endl;
+
+        auto* result = new juce::DynamicObject();
+        result->setProperty ("format", formatName);
+        result->setProperty ("bytes", (juce::int64) m.numBytes);
+        result->setProperty ("saveMicroseconds", m.saveMicroseconds);
+        result->setProperty ("loadMicroseconds", m.loadMicroseconds);
+        stateResults.add (juce::var (result));
+    }
+
+    std::cout << "Kernel: " << Crusher::getIsaName (Crusher::getKernel<float>().isa)
+              << " (float), " << Crusher::getIsaName (Crusher::getKernel<double>().isa)
+              << " (double), CPU: " << juce::SystemStats::getCpuModel() << std::endl;
+    std::cout << "block  chans   mode    type    steps  mix   bypass  dither  ns/smp   cyc/smp  headroom" << std::endl;
+
+    for (auto blockSize : blockSizes)
+    {
+        for (const auto& [channels, channelMode] : layoutModes)
+        {
+            for (auto precision : precisions)
+            {
+                auto precisionName = precision == juce::AudioProcessor::doublePrecision ? "double" : "float";
+
+                for (auto bypass : { false, true })
+                {
+                    for (const auto& noise : noiseSettings)
+                    {
+                        if (bypass && noise.first != 0)
+                            continue;
+
+                        auto noiseName = noise.first == 0 ? "off" : noise.second == 0 ? "tpdf" : "tpdf+ns9";
+
+                        for (auto bitSteps : bitStepValues)
+                        {
+                            for (auto mix : mixValues)
+                            {
+                                Case c { blockSize, channels, precision, bitSteps, mix, bypass, noise.first, noise.second, channelMode };
+                                auto m = runCase (c, options);
+
+                                std::cout << juce::String (blockSize).paddedRight (' ', 7)
+                                          << (juce::String (channels.size()) + "ch").paddedRight (' ', 8)
+                                          << juce::String (channelModeNames[channelMode]).paddedRight (' ', 8)
+                                          << juce::String (precisionName).paddedRight (' ', 8)
+                                          << juce::String (bitSteps, 0).paddedRight (' ', 7)
+                                          << juce::String (mix, 2).paddedRight (' ', 6)
+                                          << juce::String (bypass ? "on" : "off").paddedRight (' ', 8)
+                                          << juce::String (noiseName).paddedRight (' ', 8)
+                                          << juce::String (m.nsPerSample, 3).paddedRight (' ', 9)
+                                          << juce::String (m.cyclesPerSample, 2).paddedRight (' ', 9)
+                                          << juce::String (m.headroom, 0) << "x" << std::endl;
+
+                                auto* result = new juce::DynamicObject();
+                                result->setProperty ("blockSize", blockSize);
+                                result->setProperty ("channels", channels.size());
+                                result->setProperty ("layout", channels.getDescription());
+                                result->setProperty ("channelMode", channelModeNames[channelMode]);
+                                result->setProperty ("precision", precisionName);
+                                result->setProperty ("bitSteps", bitSteps);
+                                result->setProperty ("dryWetMix", mix);
+                                result->setProperty ("bypass", bypass);
+                                result->setProperty ("dither", noiseName);
+                                result->setProperty ("nsPerSample", m.nsPerSample);
+                                result->setProperty ("cyclesPerSample", m.cyclesPerSample);
+                                result->setProperty ("realtimeHeadroom", m.headroom);
+                                results.add (juce::var (result));
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if (options.jsonFile != juce::File())
+    {
+        auto* root = new juce::DynamicObject();
+        root->setProperty ("kernel", Crusher::getIsaName (Crusher::getKernel<float>().isa));
+        root->setProperty ("doubleKernel", Crusher::getIsaName (Crusher::getKernel<double>().isa));
+        root->setProperty ("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty ("juceVersion", juce::SystemStats::getJUCEVersion());
+        root->setProperty ("sampleRate", options.sampleRate);
+        root->setProperty ("timestamp", juce::Time::getCurrentTime().toISO8601 (true));
+        root->setProperty ("state", stateResults);
+        root->setProperty ("results", results);
+
+        if (! options.jsonFile.replaceWithText (juce::JSON::toString (juce::var (root))))
+        {
+            std::cerr << "Couldn't write " << options.jsonFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+
+    return 0;
+}